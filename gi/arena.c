@@ -0,0 +1,194 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2011  litl, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "arena.h"
+
+/* Chunks are kept in a list, newest first; allocations bigger than
+ * a quarter of a chunk get a chunk of their own, sized to fit.
+ */
+#define GJS_ARENA_CHUNK_SIZE 4096
+#define GJS_ARENA_MAX_SPARE_CHUNKS 4
+
+/* Large enough for any of the types we marshal (gint64, gdouble, pointers) */
+#define GJS_ARENA_ALIGN(size) (((size) + 15) & ~(gsize)15)
+
+struct _GjsArenaChunk {
+    GjsArenaChunk *next;
+    gsize size;
+    gsize used;
+};
+
+#define CHUNK_HEADER_SIZE GJS_ARENA_ALIGN(sizeof(GjsArenaChunk))
+#define CHUNK_DATA(chunk) (((char*) (chunk)) + CHUNK_HEADER_SIZE)
+
+struct _GjsArena {
+    GjsArenaChunk *chunks;
+
+    /* Default-sized chunks released by gjs_arena_reset(), ready for reuse */
+    GjsArenaChunk *spare_chunks;
+    guint n_spare_chunks;
+};
+
+static GStaticPrivate thread_arena = G_STATIC_PRIVATE_INIT;
+
+static void
+gjs_arena_free(gpointer data)
+{
+    GjsArena *arena = data;
+    GjsArenaChunk *chunk;
+
+    while ((chunk = arena->chunks) != NULL) {
+        arena->chunks = chunk->next;
+        g_free(chunk);
+    }
+    while ((chunk = arena->spare_chunks) != NULL) {
+        arena->spare_chunks = chunk->next;
+        g_free(chunk);
+    }
+
+    g_slice_free(GjsArena, arena);
+}
+
+GjsArena *
+gjs_arena_get_thread_default(void)
+{
+    GjsArena *arena;
+
+    arena = g_static_private_get(&thread_arena);
+    if (G_UNLIKELY(arena == NULL)) {
+        arena = g_slice_new0(GjsArena);
+        g_static_private_set(&thread_arena, arena, gjs_arena_free);
+    }
+
+    return arena;
+}
+
+void
+gjs_arena_get_mark(GjsArena     *arena,
+                   GjsArenaMark *mark)
+{
+    mark->chunk = arena->chunks;
+    mark->used = arena->chunks ? arena->chunks->used : 0;
+}
+
+void
+gjs_arena_reset(GjsArena           *arena,
+                const GjsArenaMark *mark)
+{
+    GjsArenaChunk *chunk;
+
+    while ((chunk = arena->chunks) != mark->chunk) {
+        g_assert(chunk != NULL);
+
+        arena->chunks = chunk->next;
+
+        if (chunk->size == GJS_ARENA_CHUNK_SIZE &&
+            arena->n_spare_chunks < GJS_ARENA_MAX_SPARE_CHUNKS) {
+            chunk->next = arena->spare_chunks;
+            arena->spare_chunks = chunk;
+            arena->n_spare_chunks += 1;
+        } else {
+            g_free(chunk);
+        }
+    }
+
+    if (chunk != NULL)
+        chunk->used = mark->used;
+}
+
+static GjsArenaChunk *
+new_chunk(GjsArena *arena,
+          gsize     size)
+{
+    GjsArenaChunk *chunk;
+
+    if (size == GJS_ARENA_CHUNK_SIZE && arena->spare_chunks != NULL) {
+        chunk = arena->spare_chunks;
+        arena->spare_chunks = chunk->next;
+        arena->n_spare_chunks -= 1;
+    } else {
+        chunk = g_malloc(CHUNK_HEADER_SIZE + size);
+        chunk->size = size;
+    }
+
+    chunk->used = 0;
+    return chunk;
+}
+
+gpointer
+gjs_arena_alloc(GjsArena *arena,
+                gsize     size)
+{
+    GjsArenaChunk *chunk;
+    gpointer result;
+
+    size = GJS_ARENA_ALIGN(MAX(size, 1));
+    chunk = arena->chunks;
+
+    if (G_UNLIKELY(chunk == NULL || chunk->size - chunk->used < size)) {
+        if (size > GJS_ARENA_CHUNK_SIZE / 4) {
+            /* Big allocations get a chunk of their own, full from
+             * the start, so they never sit in a reusable chunk.
+             */
+            GjsArenaChunk *big = new_chunk(arena, size);
+            big->used = size;
+            big->next = arena->chunks;
+            arena->chunks = big;
+            return CHUNK_DATA(big);
+        }
+
+        chunk = new_chunk(arena, GJS_ARENA_CHUNK_SIZE);
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    result = CHUNK_DATA(chunk) + chunk->used;
+    chunk->used += size;
+
+    return result;
+}
+
+gpointer
+gjs_arena_alloc0(GjsArena *arena,
+                 gsize     size)
+{
+    gpointer result = gjs_arena_alloc(arena, size);
+
+    memset(result, 0, size);
+    return result;
+}
+
+gpointer
+gjs_arena_memdup(GjsArena     *arena,
+                 gconstpointer data,
+                 gsize         size)
+{
+    gpointer result = gjs_arena_alloc(arena, size);
+
+    memcpy(result, data, size);
+    return result;
+}
@@ -0,0 +1,69 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2011  litl, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef __GJS_ARENA_H__
+#define __GJS_ARENA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A bump allocator for short-lived marshalling temporaries.
+ *
+ * Transfer-none arguments only need their C representation for the
+ * duration of a call, so instead of a g_malloc()/g_free() pair per
+ * string or array they are carved out of an arena which is rewound
+ * to a saved mark once the call has returned. There is one arena per
+ * thread; nested invocations (e.g. from a callback into JS that calls
+ * into C again) save and restore their own marks, so they just stack.
+ *
+ * Nothing allocated from the arena may be freed individually or
+ * handed to C code that keeps it past the call.
+ */
+
+typedef struct _GjsArena      GjsArena;
+typedef struct _GjsArenaChunk GjsArenaChunk;
+
+typedef struct {
+    GjsArenaChunk *chunk;
+    gsize          used;
+} GjsArenaMark;
+
+GjsArena *gjs_arena_get_thread_default (void);
+
+void      gjs_arena_get_mark (GjsArena           *arena,
+                              GjsArenaMark       *mark);
+void      gjs_arena_reset    (GjsArena           *arena,
+                              const GjsArenaMark *mark);
+
+gpointer  gjs_arena_alloc    (GjsArena           *arena,
+                              gsize               size);
+gpointer  gjs_arena_alloc0   (GjsArena           *arena,
+                              gsize               size);
+gpointer  gjs_arena_memdup   (GjsArena           *arena,
+                              gconstpointer       data,
+                              gsize               size);
+
+G_END_DECLS
+
+#endif  /* __GJS_ARENA_H__ */
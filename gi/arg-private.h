@@ -0,0 +1,49 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2011  litl, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Marshalling entry points that use the call arena; only for
+ * function.c, not installed.
+ */
+
+#ifndef __GJS_ARG_PRIVATE_H__
+#define __GJS_ARG_PRIVATE_H__
+
+#include "arg.h"
+#include "arena.h"
+
+G_BEGIN_DECLS
+
+gboolean gjs_g_argument_can_use_arena (GITypeInfo *type_info);
+
+JSBool gjs_value_to_g_argument_in_arena (JSContext      *context,
+                                         jsval           value,
+                                         GITypeInfo     *type_info,
+                                         const char     *arg_name,
+                                         GjsArgumentType arg_type,
+                                         gboolean        may_be_null,
+                                         GjsArena       *arena,
+                                         GArgument      *arg);
+
+G_END_DECLS
+
+#endif  /* __GJS_ARG_PRIVATE_H__ */
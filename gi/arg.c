@@ -23,7 +23,10 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "arg.h"
+#include "arg-private.h"
 #include "object.h"
 #include "foreign.h"
 #include "boxed.h"
@@ -233,6 +236,21 @@ type_needs_release (GITypeInfo *type_info,
     }
 }
 
+static JSBool value_to_g_argument(JSContext      *context,
+                                  jsval           value,
+                                  GITypeInfo     *type_info,
+                                  const char     *arg_name,
+                                  GjsArgumentType arg_type,
+                                  GITransfer      transfer,
+                                  gboolean        may_be_null,
+                                  GjsArena       *arena,
+                                  GArgument      *arg);
+
+/* With an @arena, all the list nodes are carved out of it in one block
+ * and linked up front; they go away with the arena, so the list must
+ * not be freed with g_list_free(). Otherwise nodes come from GSlice as
+ * usual.
+ */
 static JSBool
 gjs_array_to_g_list(JSContext   *context,
                     jsval        array_value,
@@ -240,16 +258,21 @@ gjs_array_to_g_list(JSContext   *context,
                     GITypeInfo  *param_info,
                     GITransfer   transfer,
                     GITypeTag    list_type,
+                    GjsArena    *arena,
                     GList      **list_p,
                     GSList     **slist_p)
 {
     guint32 i;
     GList *list;
     GSList *slist;
+    GList *nodes;
+    GSList *snodes;
     jsval elem;
 
     list = NULL;
     slist = NULL;
+    nodes = NULL;
+    snodes = NULL;
 
     if (transfer == GI_TRANSFER_CONTAINER) {
         if (type_needs_release (param_info, g_type_info_get_tag(param_info))) {
@@ -265,6 +288,13 @@ gjs_array_to_g_list(JSContext   *context,
         transfer = GI_TRANSFER_NOTHING;
     }
 
+    if (arena != NULL && length > 0) {
+        if (list_type == GI_TYPE_TAG_GLIST)
+            nodes = gjs_arena_alloc(arena, sizeof(GList) * length);
+        else
+            snodes = gjs_arena_alloc(arena, sizeof(GSList) * length);
+    }
+
     for (i = 0; i < length; ++i) {
         GArgument elem_arg;
 
@@ -281,18 +311,26 @@ gjs_array_to_g_list(JSContext   *context,
          * gobject-introspection needs to tell us this.
          * Always say they can't for now.
          */
-        if (!gjs_value_to_g_argument(context,
-                                     elem,
-                                     param_info,
-                                     NULL,
-                                     GJS_ARGUMENT_LIST_ELEMENT,
-                                     transfer,
-                                     FALSE,
-                                     &elem_arg)) {
+        if (!value_to_g_argument(context,
+                                 elem,
+                                 param_info,
+                                 NULL,
+                                 GJS_ARGUMENT_LIST_ELEMENT,
+                                 transfer,
+                                 FALSE,
+                                 arena,
+                                 &elem_arg)) {
             return JS_FALSE;
         }
 
-        if (list_type == GI_TYPE_TAG_GLIST) {
+        if (nodes != NULL) {
+            nodes[i].data = elem_arg.v_pointer;
+            nodes[i].prev = i > 0 ? &nodes[i - 1] : NULL;
+            nodes[i].next = i + 1 < length ? &nodes[i + 1] : NULL;
+        } else if (snodes != NULL) {
+            snodes[i].data = elem_arg.v_pointer;
+            snodes[i].next = i + 1 < length ? &snodes[i + 1] : NULL;
+        } else if (list_type == GI_TYPE_TAG_GLIST) {
             /* GList */
             list = g_list_prepend(list, elem_arg.v_pointer);
         } else {
@@ -301,8 +339,13 @@ gjs_array_to_g_list(JSContext   *context,
         }
     }
 
-    list = g_list_reverse(list);
-    slist = g_slist_reverse(slist);
+    if (arena != NULL) {
+        list = nodes;
+        slist = snodes;
+    } else {
+        list = g_list_reverse(list);
+        slist = g_slist_reverse(slist);
+    }
 
     *list_p = list;
     *slist_p = slist;
@@ -320,8 +363,8 @@ gjs_object_to_g_hash(JSContext   *context,
 {
     GHashTable *result = NULL;
     JSObject *props;
-    JSObject *iter;
-    jsid prop_id;
+    JSIdArray *ids;
+    jsint i;
 
     g_assert(JSVAL_IS_OBJECT(hash_value));
     props = JSVAL_TO_OBJECT(hash_value);
@@ -341,20 +384,20 @@ gjs_object_to_g_hash(JSContext   *context,
         transfer = GI_TRANSFER_NOTHING;
     }
 
-    iter = JS_NewPropertyIterator(context, props);
-    if (iter == NULL)
-        return JS_FALSE;
-
-    prop_id = JSID_VOID;
-    if (!JS_NextProperty(context, iter, &prop_id))
+    /* Take a snapshot of the ids in one go rather than stepping a
+     * property iterator, which does a lookup round trip per property.
+     */
+    ids = JS_Enumerate(context, props);
+    if (ids == NULL)
         return JS_FALSE;
 
     /* Don't use key/value destructor functions here, because we can't
      * construct correct ones in general if the value type is complex.
      * Rely on the type-aware g_argument_release functions. */
-   result = g_hash_table_new(g_str_hash, g_str_equal);
+    result = g_hash_table_new(g_str_hash, g_str_equal);
 
-   while (!JSID_IS_VOID(prop_id)) {
+    for (i = 0; i < ids->length; i++) {
+        jsid prop_id = ids->vector[i];
         jsval key_js, val_js;
         GArgument key_arg, val_arg;
 
@@ -386,16 +429,15 @@ gjs_object_to_g_hash(JSContext   *context,
             goto free_hash_and_fail;
 
         g_hash_table_insert(result, key_arg.v_pointer, val_arg.v_pointer);
-
-        prop_id = JSID_VOID;
-        if (!JS_NextProperty(context, iter, &prop_id))
-            goto free_hash_and_fail;
     }
 
+    JS_DestroyIdArray(context, ids);
+
     *hash_p = result;
     return JS_TRUE;
 
  free_hash_and_fail:
+    JS_DestroyIdArray(context, ids);
     g_hash_table_destroy(result);
     return JS_FALSE;
 }
@@ -437,24 +479,104 @@ out:
     return result;
 }
 
-JSBool
-gjs_array_to_strv(JSContext   *context,
-                  jsval        array_value,
-                  unsigned int length,
-                  void       **arr_p)
+/* Allocation helpers for the converters below, which take their
+ * memory from @arena instead of the heap when one is given; see
+ * gjs_value_to_g_argument_in_arena().
+ */
+static inline gpointer
+marshal_alloc0(GjsArena *arena,
+               gsize     size)
+{
+    if (arena != NULL)
+        return gjs_arena_alloc0(arena, size);
+    return g_malloc0(size);
+}
+
+static inline gpointer
+marshal_memdup(GjsArena     *arena,
+               gconstpointer data,
+               gsize         size)
+{
+    if (arena != NULL)
+        return gjs_arena_memdup(arena, data, size);
+    return g_memdup(data, size);
+}
+
+static inline void
+marshal_free(GjsArena *arena,
+             gpointer  mem)
+{
+    if (arena == NULL)
+        g_free(mem);
+}
+
+/* Like gjs_string_to_utf8(), but the result lives in @arena. ASCII
+ * strings, by far the most common kind passed to C, are narrowed
+ * straight into the arena without a heap round trip.
+ */
+static JSBool
+string_to_utf8_in_arena(JSContext  *context,
+                        GjsArena   *arena,
+                        jsval       string_val,
+                        char      **utf8_string_p)
+{
+    const jschar *s;
+    size_t s_length;
+    size_t i;
+    char *utf8_string;
+
+#ifdef HAVE_JS_GETSTRINGCHARS
+    s = JS_GetStringChars(JSVAL_TO_STRING(string_val));
+    s_length = JS_GetStringLength(JSVAL_TO_STRING(string_val));
+#else
+    s = JS_GetStringCharsAndLength(context, JSVAL_TO_STRING(string_val), &s_length);
+    if (s == NULL)
+        return JS_FALSE;
+#endif
+
+    for (i = 0; i < s_length; i++) {
+        if (s[i] == 0 || s[i] >= 0x80)
+            break;
+    }
+
+    if (i == s_length) {
+        char *result = gjs_arena_alloc(arena, s_length + 1);
+        for (i = 0; i < s_length; i++)
+            result[i] = (char) s[i];
+        result[s_length] = '\0';
+        *utf8_string_p = result;
+        return JS_TRUE;
+    }
+
+    /* Non-ASCII (or embedded NULs, which this reports) */
+    if (!gjs_string_to_utf8(context, string_val, &utf8_string))
+        return JS_FALSE;
+    *utf8_string_p = gjs_arena_memdup(arena, utf8_string, strlen(utf8_string) + 1);
+    g_free(utf8_string);
+
+    return JS_TRUE;
+}
+
+static JSBool
+array_to_strv(JSContext   *context,
+              GjsArena    *arena,
+              jsval        array_value,
+              unsigned int length,
+              void       **arr_p)
 {
     char **result;
     guint32 i;
 
-    result = g_new0(char *, length+1);
+    result = marshal_alloc0(arena, sizeof(char *) * (length + 1));
 
     for (i = 0; i < length; ++i) {
         jsval elem;
+        JSBool converted;
 
         elem = JSVAL_VOID;
         if (!JS_GetElement(context, JSVAL_TO_OBJECT(array_value),
                            i, &elem)) {
-            g_free(result);
+            marshal_free(arena, result);
             gjs_throw(context,
                       "Missing array element %u",
                       i);
@@ -464,11 +586,19 @@ gjs_array_to_strv(JSContext   *context,
         if (!JSVAL_IS_STRING(elem)) {
             gjs_throw(context,
                       "Invalid element in string array");
-            g_strfreev(result);
+            if (arena == NULL)
+                g_strfreev(result);
             return JS_FALSE;
         }
-        if (!gjs_string_to_utf8(context, elem, (char **)&(result[i]))) {
-            g_strfreev(result);
+
+        if (arena != NULL)
+            converted = string_to_utf8_in_arena(context, arena, elem, &result[i]);
+        else
+            converted = gjs_string_to_utf8(context, elem, &result[i]);
+
+        if (!converted) {
+            if (arena == NULL)
+                g_strfreev(result);
             return JS_FALSE;
         }
     }
@@ -478,8 +608,18 @@ gjs_array_to_strv(JSContext   *context,
     return JS_TRUE;
 }
 
+JSBool
+gjs_array_to_strv(JSContext   *context,
+                  jsval        array_value,
+                  unsigned int length,
+                  void       **arr_p)
+{
+    return array_to_strv(context, NULL, array_value, length, arr_p);
+}
+
 static JSBool
 gjs_string_to_intarray(JSContext   *context,
+                       GjsArena    *arena,
                        jsval        string_val,
                        GITypeInfo  *param_info,
                        void       **arr_p)
@@ -498,7 +638,12 @@ gjs_string_to_intarray(JSContext   *context,
         if (!gjs_string_get_binary_data(context, string_val,
                                         &result, &length))
             return JS_FALSE;
-        *arr_p = result;
+        if (arena != NULL) {
+            *arr_p = gjs_arena_memdup(arena, result, length);
+            g_free(result);
+        } else {
+            *arr_p = result;
+        }
         return JS_TRUE;
 
     case GI_TYPE_TAG_INT16:
@@ -506,7 +651,12 @@ gjs_string_to_intarray(JSContext   *context,
         if (!gjs_string_get_uint16_data(context, string_val,
                                         &result16, &length))
             return JS_FALSE;
-        *arr_p = result16;
+        if (arena != NULL) {
+            *arr_p = gjs_arena_memdup(arena, result16, length * sizeof(guint16));
+            g_free(result16);
+        } else {
+            *arr_p = result16;
+        }
         return JS_TRUE;
 
     default:
@@ -517,72 +667,222 @@ gjs_string_to_intarray(JSContext   *context,
     }
 }
 
-static JSBool
-gjs_array_to_intarray(JSContext   *context,
-                      jsval        array_value,
-                      unsigned int length,
-                      void       **arr_p,
-                      unsigned intsize,
-                      gboolean is_signed)
+/* Per-element conversions for gjs_array_to_numeric_array(); ints are
+ * by far the most common element values, so check for them inline
+ * before going through the generic JSAPI conversion.
+ */
+static inline JSBool
+element_to_int32(JSContext *context,
+                 jsval      elem,
+                 gint32    *out)
+{
+    if (JSVAL_IS_INT(elem)) {
+        *out = JSVAL_TO_INT(elem);
+        return JS_TRUE;
+    }
+    return JS_ValueToECMAInt32(context, elem, out);
+}
+
+static inline JSBool
+element_to_uint32(JSContext *context,
+                  jsval      elem,
+                  guint32   *out)
+{
+    if (JSVAL_IS_INT(elem)) {
+        *out = (guint32) JSVAL_TO_INT(elem);
+        return JS_TRUE;
+    }
+    return JS_ValueToECMAUint32(context, elem, out);
+}
+
+static inline JSBool
+element_to_double(JSContext *context,
+                  jsval      elem,
+                  gdouble   *out)
+{
+    if (JSVAL_IS_INT(elem)) {
+        *out = JSVAL_TO_INT(elem);
+        return JS_TRUE;
+    }
+    return JS_ValueToNumber(context, elem, out);
+}
+
+/* Copies the bytes of a ByteArray into a C array of the given numeric
+ * type, in one memcpy for 8-bit elements.
+ */
+static void
+gjs_byte_array_to_numeric_array(GjsArena   *arena,
+                                GByteArray *byte_array,
+                                unsigned    length,
+                                GITypeTag   element_type,
+                                void      **arr_p)
 {
-    /* nasty union types in an attempt to unify the various int types */
-    union { guint32 u; gint32 i; } intval;
-    union { guint8 u8[0]; guint16 u16[0]; guint32 u32[0]; } *result;
     unsigned i;
 
-    result = g_malloc0(length * intsize);
+    length = MIN(length, byte_array->len);
 
-    for (i = 0; i < length; ++i) {
-        jsval elem;
-        JSBool success;
+#define WIDEN_BYTES(ctype)                                      \
+    {                                                           \
+        ctype *out = marshal_alloc0(arena, sizeof(ctype) * length); \
+        for (i = 0; i < length; ++i)                            \
+            out[i] = byte_array->data[i];                       \
+        *arr_p = out;                                           \
+    }
 
-        elem = JSVAL_VOID;
-        if (!JS_GetElement(context, JSVAL_TO_OBJECT(array_value),
-                           i, &elem)) {
-            g_free(result);
-            gjs_throw(context,
-                      "Missing array element %u",
-                      i);
-            return JS_FALSE;
-        }
+    switch (element_type) {
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+        *arr_p = marshal_memdup(arena, byte_array->data, length);
+        break;
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+        WIDEN_BYTES(guint16);
+        break;
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+        WIDEN_BYTES(guint32);
+        break;
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+        WIDEN_BYTES(guint64);
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        WIDEN_BYTES(gfloat);
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        WIDEN_BYTES(gdouble);
+        break;
+    default:
+        g_assert_not_reached();
+    }
 
-        /* do whatever sign extension is appropriate */
-        success = (is_signed) ?
-            JS_ValueToECMAInt32(context, elem, &(intval.i)) :
-            JS_ValueToECMAUint32(context, elem, &(intval.u));
+#undef WIDEN_BYTES
+}
 
-        if (!success) {
-            g_free(result);
-            gjs_throw(context,
-                      "Invalid element in string array");
-            return JS_FALSE;
-        }
-        /* Note that this is truncating assignment. */
-        switch (intsize) {
-        case 1:
-            result->u8[i] = (gint8) intval.u; break;
-        case 2:
-            result->u16[i] = (gint16) intval.u; break;
-        case 4:
-            result->u32[i] = (gint32) intval.u; break;
-        default:
-            g_assert_not_reached();
-        }
+/* Converts a JS array (or ByteArray) of numbers to a C array of any
+ * numeric element type. The element type dispatch is hoisted out of
+ * the loop so each type gets a tight loop of its own.
+ */
+static JSBool
+gjs_array_to_numeric_array(JSContext   *context,
+                           GjsArena    *arena,
+                           jsval        array_value,
+                           unsigned int length,
+                           GITypeTag    element_type,
+                           void       **arr_p)
+{
+    JSObject *array_obj;
+    GByteArray *byte_array;
+    void *result;
+    unsigned i;
+
+    array_obj = JSVAL_TO_OBJECT(array_value);
+
+    byte_array = gjs_byte_array_get_byte_array(context, array_obj);
+    if (byte_array != NULL) {
+        gjs_byte_array_to_numeric_array(arena, byte_array, length, element_type, arr_p);
+        return JS_TRUE;
+    }
+
+    /* Integers up to 32 bits wrap like the ECMA conversions do; wider
+     * ones and floats are range checked like gjs_value_to_g_argument()
+     * does for single values, since the cast is undefined otherwise.
+     */
+#define CONVERT_ELEMENTS(ctype, jstype, convert, in_range)              \
+    {                                                                   \
+        ctype *out = marshal_alloc0(arena, sizeof(ctype) * length);     \
+        result = out;                                                   \
+        for (i = 0; i < length; ++i) {                                  \
+            jsval elem;                                                 \
+            jstype v;                                                   \
+                                                                        \
+            elem = JSVAL_VOID;                                          \
+            if (!JS_GetElement(context, array_obj, i, &elem))           \
+                goto missing;                                           \
+            if (!convert(context, elem, &v))                            \
+                goto invalid;                                           \
+            if (!(in_range))                                            \
+                goto out_of_range;                                      \
+            /* Note that this is truncating assignment. */              \
+            out[i] = (ctype) v;                                         \
+        }                                                               \
     }
 
+    switch (element_type) {
+    case GI_TYPE_TAG_INT8:
+        CONVERT_ELEMENTS(gint8, gint32, element_to_int32, TRUE);
+        break;
+    case GI_TYPE_TAG_UINT8:
+        CONVERT_ELEMENTS(guint8, guint32, element_to_uint32, TRUE);
+        break;
+    case GI_TYPE_TAG_INT16:
+        CONVERT_ELEMENTS(gint16, gint32, element_to_int32, TRUE);
+        break;
+    case GI_TYPE_TAG_UINT16:
+        CONVERT_ELEMENTS(guint16, guint32, element_to_uint32, TRUE);
+        break;
+    case GI_TYPE_TAG_INT32:
+        CONVERT_ELEMENTS(gint32, gint32, element_to_int32, TRUE);
+        break;
+    case GI_TYPE_TAG_UINT32:
+        CONVERT_ELEMENTS(guint32, guint32, element_to_uint32, TRUE);
+        break;
+    case GI_TYPE_TAG_INT64:
+        /* (gdouble) G_MAXINT64 rounds up to 2^63, which doesn't fit */
+        CONVERT_ELEMENTS(gint64, gdouble, element_to_double,
+                         v >= (gdouble) G_MININT64 && v < (gdouble) G_MAXINT64);
+        break;
+    case GI_TYPE_TAG_UINT64:
+        CONVERT_ELEMENTS(guint64, gdouble, element_to_double,
+                         v >= 0 && v < (gdouble) G_MAXUINT64);
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        /* NaN is let through, as for single values */
+        CONVERT_ELEMENTS(gfloat, gdouble, element_to_double,
+                         !(v > G_MAXFLOAT || v < - G_MAXFLOAT));
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        CONVERT_ELEMENTS(gdouble, gdouble, element_to_double, TRUE);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+#undef CONVERT_ELEMENTS
+
     *arr_p = result;
 
     return JS_TRUE;
+
+ missing:
+    marshal_free(arena, result);
+    gjs_throw(context,
+              "Missing array element %u",
+              i);
+    return JS_FALSE;
+
+ invalid:
+    marshal_free(arena, result);
+    gjs_throw(context,
+              "Invalid element in numeric array");
+    return JS_FALSE;
+
+ out_of_range:
+    marshal_free(arena, result);
+    gjs_throw(context,
+              "Array element %u is out of range for type %s",
+              i, g_type_tag_to_string(element_type));
+    return JS_FALSE;
 }
 
 static JSBool
 gjs_array_to_array(JSContext   *context,
+                   GjsArena    *arena,
                    jsval        array_value,
                    unsigned int length,
                    GITypeInfo  *param_info,
                    void       **arr_p)
 {
-    enum { UNSIGNED=FALSE, SIGNED=TRUE };
     GITypeTag element_type;
 
     element_type = g_type_info_get_tag(param_info);
@@ -590,25 +890,19 @@ gjs_array_to_array(JSContext   *context,
 
     switch (element_type) {
     case GI_TYPE_TAG_UTF8:
-        return gjs_array_to_strv (context, array_value, length, arr_p);
+        return array_to_strv (context, arena, array_value, length, arr_p);
     case GI_TYPE_TAG_UINT8:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 1, UNSIGNED);
     case GI_TYPE_TAG_INT8:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 1, SIGNED);
     case GI_TYPE_TAG_UINT16:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 2, UNSIGNED);
     case GI_TYPE_TAG_INT16:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 2, SIGNED);
     case GI_TYPE_TAG_UINT32:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 4, UNSIGNED);
     case GI_TYPE_TAG_INT32:
-        return gjs_array_to_intarray
-            (context, array_value, length, arr_p, 4, SIGNED);
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+        return gjs_array_to_numeric_array
+            (context, arena, array_value, length, element_type, arr_p);
     default:
         gjs_throw(context,
                   "Unhandled array element type %d", element_type);
@@ -648,6 +942,12 @@ gjs_array_to_g_array(JSContext   *context,
     case GI_TYPE_TAG_INT64:
       element_size = sizeof(guint64);
       break;
+    case GI_TYPE_TAG_FLOAT:
+      element_size = sizeof(gfloat);
+      break;
+    case GI_TYPE_TAG_DOUBLE:
+      element_size = sizeof(gdouble);
+      break;
     default:
         gjs_throw(context,
                   "Unhandled GArray element-type %d", element_type);
@@ -656,6 +956,7 @@ gjs_array_to_g_array(JSContext   *context,
 
     /* create a C array */
     if (!gjs_array_to_array (context,
+                             NULL,
                              array_value,
                              length,
                              param_info,
@@ -708,15 +1009,16 @@ get_argument_display_name(const char     *arg_name,
     g_assert_not_reached ();
 }
 
-JSBool
-gjs_value_to_g_argument(JSContext      *context,
-                        jsval           value,
-                        GITypeInfo     *type_info,
-                        const char     *arg_name,
-                        GjsArgumentType arg_type,
-                        GITransfer      transfer,
-                        gboolean        may_be_null,
-                        GArgument      *arg)
+static JSBool
+value_to_g_argument(JSContext      *context,
+                    jsval           value,
+                    GITypeInfo     *type_info,
+                    const char     *arg_name,
+                    GjsArgumentType arg_type,
+                    GITransfer      transfer,
+                    gboolean        may_be_null,
+                    GjsArena       *arena,
+                    GArgument      *arg)
 {
     GITypeTag type_tag;
     gboolean wrong;
@@ -868,7 +1170,14 @@ gjs_value_to_g_argument(JSContext      *context,
             arg->v_pointer = NULL;
         } else if (JSVAL_IS_STRING(value)) {
             char *utf8_str;
-            if (gjs_string_to_utf8(context, value, &utf8_str))
+            JSBool converted;
+
+            if (arena != NULL)
+                converted = string_to_utf8_in_arena(context, arena, value, &utf8_str);
+            else
+                converted = gjs_string_to_utf8(context, value, &utf8_str);
+
+            if (converted)
                 // doing this as a separate step to avoid type-punning
                 arg->v_pointer = utf8_str;
             else
@@ -1105,6 +1414,7 @@ gjs_value_to_g_argument(JSContext      *context,
                                          param_info,
                                          transfer,
                                          type_tag,
+                                         arena,
                                          &list, &slist)) {
                     wrong = TRUE;
                 }
@@ -1172,7 +1482,7 @@ gjs_value_to_g_argument(JSContext      *context,
             param_info = g_type_info_get_param_type(type_info, 0);
             g_assert(param_info != NULL);
 
-            if (!gjs_string_to_intarray(context, value, param_info,
+            if (!gjs_string_to_intarray(context, arena, value, param_info,
                                         &arg->v_pointer))
                 wrong = TRUE;
 
@@ -1201,6 +1511,7 @@ gjs_value_to_g_argument(JSContext      *context,
 
                 if (array_type == GI_ARRAY_TYPE_C) {
                     if (!gjs_array_to_array (context,
+                                             arena,
                                              value,
                                              length,
                                              param_info,
@@ -1282,6 +1593,96 @@ gjs_value_to_g_argument(JSContext      *context,
     }
 }
 
+/* Converts @value with memory from the heap; see also gjs_value_to_g_argument_in_arena() */
+JSBool
+gjs_value_to_g_argument(JSContext      *context,
+                        jsval           value,
+                        GITypeInfo     *type_info,
+                        const char     *arg_name,
+                        GjsArgumentType arg_type,
+                        GITransfer      transfer,
+                        gboolean        may_be_null,
+                        GArgument      *arg)
+{
+    return value_to_g_argument(context, value, type_info, arg_name,
+                               arg_type, transfer, may_be_null,
+                               NULL, arg);
+}
+
+/* Whether a transfer-none in argument of this type can be converted
+ * entirely into an arena by gjs_value_to_g_argument_in_arena(): strings,
+ * C arrays of strings or numbers, and lists whose elements either can
+ * be converted into the arena too or need no releasing at all. For
+ * these types, the conversion allocates nothing on the heap, so there
+ * is nothing to release.
+ */
+gboolean
+gjs_g_argument_can_use_arena(GITypeInfo *type_info)
+{
+    GITypeInfo *param_info;
+    GITypeTag element_type;
+    gboolean result;
+
+    switch (g_type_info_get_tag(type_info)) {
+    case GI_TYPE_TAG_UTF8:
+        return TRUE;
+    case GI_TYPE_TAG_ARRAY:
+        if (g_type_info_get_array_type(type_info) != GI_ARRAY_TYPE_C)
+            return FALSE;
+        break;
+    case GI_TYPE_TAG_GLIST:
+    case GI_TYPE_TAG_GSLIST:
+        param_info = g_type_info_get_param_type(type_info, 0);
+        result = gjs_g_argument_can_use_arena(param_info) ||
+            !type_needs_release(param_info, g_type_info_get_tag(param_info));
+        g_base_info_unref((GIBaseInfo*) param_info);
+        return result;
+    default:
+        return FALSE;
+    }
+
+    param_info = g_type_info_get_param_type(type_info, 0);
+    element_type = replace_gtype(g_type_info_get_tag(param_info));
+    g_base_info_unref((GIBaseInfo*) param_info);
+
+    switch (element_type) {
+    case GI_TYPE_TAG_UTF8:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* Converts a transfer-none argument of a type accepted by
+ * gjs_g_argument_can_use_arena(), taking all the memory for it from
+ * @arena. The result must not be released; it goes away when the
+ * arena is reset.
+ */
+JSBool
+gjs_value_to_g_argument_in_arena(JSContext      *context,
+                                 jsval           value,
+                                 GITypeInfo     *type_info,
+                                 const char     *arg_name,
+                                 GjsArgumentType arg_type,
+                                 gboolean        may_be_null,
+                                 GjsArena       *arena,
+                                 GArgument      *arg)
+{
+    return value_to_g_argument(context, value, type_info, arg_name,
+                               arg_type, GI_TRANSFER_NOTHING, may_be_null,
+                               arena, arg);
+}
+
 /* If a callback function with a return value throws, we still have
  * to return something to C. This function defines what that something
  * is. It basically boils down to memset(arg, 0, sizeof(*arg)), but
@@ -1434,12 +1835,21 @@ gjs_array_from_g_list (JSContext  *context,
                        GSList     *slist)
 {
     JSObject *obj;
-    unsigned int i;
+    unsigned int i, length;
     jsval elem;
     GArgument arg;
     JSBool result;
 
-    obj = JS_NewArrayObject(context, 0, NULL);
+    /* Size the array up front so filling it in doesn't keep
+     * growing its storage; long lists are common (tree model
+     * children, enumerated files).
+     */
+    if (list_tag == GI_TYPE_TAG_GLIST)
+        length = g_list_length(list);
+    else
+        length = g_slist_length(slist);
+
+    obj = JS_NewArrayObject(context, length, NULL);
     if (obj == NULL)
         return JS_FALSE;
 
@@ -1450,37 +1860,22 @@ gjs_array_from_g_list (JSContext  *context,
 
     result = JS_FALSE;
 
-    i = 0;
-    if (list_tag == GI_TYPE_TAG_GLIST) {
-        for ( ; list != NULL; list = list->next) {
+    for (i = 0; i < length; i++) {
+        if (list_tag == GI_TYPE_TAG_GLIST) {
             arg.v_pointer = list->data;
-
-            if (!gjs_value_from_g_argument(context, &elem,
-                                           param_info, &arg))
-                goto out;
-
-            if (!JS_DefineElement(context, obj,
-                                  i, elem,
-                                  NULL, NULL, JSPROP_ENUMERATE)) {
-                goto out;
-            }
-            ++i;
-        }
-    } else {
-        for ( ; slist != NULL; slist = slist->next) {
+            list = list->next;
+        } else {
             arg.v_pointer = slist->data;
+            slist = slist->next;
+        }
 
-            if (!gjs_value_from_g_argument(context, &elem,
-                                           param_info, &arg))
-                goto out;
+        if (!gjs_value_from_g_argument(context, &elem,
+                                       param_info, &arg))
+            goto out;
 
-            if (!JS_DefineElement(context, obj,
-                                  i, elem,
-                                  NULL, NULL, JSPROP_ENUMERATE)) {
-                goto out;
-            }
-            ++i;
-        }
+        if (!JS_DefineElement(context, obj, i, elem,
+                              NULL, NULL, JSPROP_ENUMERATE))
+            goto out;
     }
 
     result = JS_TRUE;
@@ -1580,6 +1975,150 @@ finally:
     return result;
 }
 
+/* Fills @elems with the values of a C array of numbers. Values that
+ * don't fit in an int jsval may allocate, so this must be called in a
+ * local root scope.
+ */
+static JSBool
+fill_numeric_elements(JSContext *context,
+                      GITypeTag  element_type,
+                      gpointer   array,
+                      guint      length,
+                      jsval     *elems)
+{
+    guint i;
+
+#define FILL(type, fits)                                                \
+    for (i = 0; i < length; i++) {                                     \
+        type v = ((type*)array)[i];                                     \
+        if (fits)                                                       \
+            elems[i] = INT_TO_JSVAL((int)v);                            \
+        else if (!JS_NewNumberValue(context, (double)v, &elems[i]))     \
+            return JS_FALSE;                                            \
+    }
+
+    switch (element_type) {
+    case GI_TYPE_TAG_INT8:
+        FILL(gint8, TRUE);
+        break;
+    case GI_TYPE_TAG_INT16:
+        FILL(gint16, TRUE);
+        break;
+    case GI_TYPE_TAG_UINT16:
+        FILL(guint16, TRUE);
+        break;
+    case GI_TYPE_TAG_INT32:
+        FILL(gint32, v >= JSVAL_INT_MIN && v <= JSVAL_INT_MAX);
+        break;
+    case GI_TYPE_TAG_UINT32:
+        FILL(guint32, v <= (guint32) JSVAL_INT_MAX);
+        break;
+    case GI_TYPE_TAG_INT64:
+        FILL(gint64, v >= JSVAL_INT_MIN && v <= JSVAL_INT_MAX);
+        break;
+    case GI_TYPE_TAG_UINT64:
+        FILL(guint64, v <= (guint64) JSVAL_INT_MAX);
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        FILL(float, FALSE);
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        FILL(double, FALSE);
+        break;
+    default:
+        g_assert_not_reached();
+        break;
+    }
+
+#undef FILL
+
+    return JS_TRUE;
+}
+
+/* Converts a C array whose length is not encoded in the array itself
+ * (it comes from a separate length argument, or is fixed-size).
+ * guint8 arrays become a ByteArray, which is a single copy of the data
+ * and doesn't create per-element jsvals until they are read. Other
+ * numeric arrays are still plain arrays with a jsval per element, but
+ * are created in one go from a prefilled vector.
+ */
+JSBool
+gjs_value_from_explicit_array(JSContext  *context,
+                              jsval      *value_p,
+                              GITypeInfo *type_info,
+                              GArgument  *arg,
+                              int         length)
+{
+    GITypeInfo *param_info;
+    GITypeTag element_type;
+    JSObject *obj;
+    jsval *elems;
+    JSBool result;
+
+    /* C APIs commonly return NULL for an empty array */
+    if (length < 0 || (arg->v_pointer == NULL && length > 0)) {
+        *value_p = JSVAL_NULL;
+        return JS_TRUE;
+    }
+
+    param_info = g_type_info_get_param_type(type_info, 0);
+    element_type = g_type_info_get_tag(param_info);
+    element_type = replace_gtype(element_type);
+    g_base_info_unref((GIBaseInfo*) param_info);
+
+    switch (element_type) {
+    case GI_TYPE_TAG_UINT8:
+        obj = gjs_byte_array_from_data(context, length, arg->v_pointer);
+        if (obj == NULL)
+            return JS_FALSE;
+        *value_p = OBJECT_TO_JSVAL(obj);
+        return JS_TRUE;
+
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+        break;
+
+    default:
+        gjs_throw(context, "FIXME: Arrays of type %s with explicit length "
+                  "are not supported",
+                  g_type_tag_to_string(element_type));
+        return JS_FALSE;
+    }
+
+    if (!JS_EnterLocalRootScope(context))
+        return JS_FALSE;
+
+    result = JS_FALSE;
+    elems = g_new(jsval, length);
+
+    if (!fill_numeric_elements(context, element_type, arg->v_pointer, length, elems))
+        goto out;
+
+    obj = JS_NewArrayObject(context, length, elems);
+    if (obj == NULL)
+        goto out;
+
+    *value_p = OBJECT_TO_JSVAL(obj);
+    result = JS_TRUE;
+
+ out:
+    g_free(elems);
+
+    if (result)
+        JS_LeaveLocalRootScopeWithResult(context, *value_p);
+    else
+        JS_LeaveLocalRootScope(context);
+
+    return result;
+}
+
 static JSBool
 gjs_object_from_g_hash (JSContext  *context,
                         jsval      *value_p,
@@ -1893,6 +2432,9 @@ gjs_value_from_g_argument (JSContext  *context,
                 g_base_info_unref((GIBaseInfo*) param_info);
 
                 return result;
+            } else if (g_type_info_get_array_fixed_size(type_info) >= 0) {
+                return gjs_value_from_explicit_array(context, value_p, type_info, arg,
+                                                     g_type_info_get_array_fixed_size(type_info));
             } else {
                 gjs_throw(context, "FIXME: Only supporting zero-terminated ARRAYs");
                 return JS_FALSE;
@@ -2169,9 +2711,13 @@ gjs_g_arg_release_internal(JSContext  *context,
             case GI_TYPE_TAG_UINT8:
             case GI_TYPE_TAG_UINT16:
             case GI_TYPE_TAG_UINT32:
+            case GI_TYPE_TAG_UINT64:
             case GI_TYPE_TAG_INT8:
             case GI_TYPE_TAG_INT16:
             case GI_TYPE_TAG_INT32:
+            case GI_TYPE_TAG_INT64:
+            case GI_TYPE_TAG_FLOAT:
+            case GI_TYPE_TAG_DOUBLE:
                 g_free (arg->v_pointer);
                 break;
 
@@ -2197,6 +2743,8 @@ gjs_g_arg_release_internal(JSContext  *context,
             case GI_TYPE_TAG_INT16:
             case GI_TYPE_TAG_INT32:
             case GI_TYPE_TAG_INT64:
+            case GI_TYPE_TAG_FLOAT:
+            case GI_TYPE_TAG_DOUBLE:
                 g_array_free((GArray*) arg->v_pointer, TRUE);
                 break;
 
@@ -63,6 +63,11 @@ JSBool gjs_value_from_g_argument (JSContext  *context,
                                   jsval      *value_p,
                                   GITypeInfo *type_info,
                                   GArgument  *arg);
+JSBool gjs_value_from_explicit_array (JSContext  *context,
+                                      jsval      *value_p,
+                                      GITypeInfo *type_info,
+                                      GArgument  *arg,
+                                      int         length);
 JSBool gjs_g_argument_release    (JSContext  *context,
                                   GITransfer  transfer,
                                   GITypeInfo *type_info,
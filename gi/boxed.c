@@ -39,11 +39,39 @@
 
 #include <girepository.h>
 
+/* A field of a boxed type, with everything the field accessors need
+ * looked up ahead of time.
+ */
+typedef struct {
+    GIFieldInfo *info;
+    GITypeInfo *type_info;
+    const char *name;
+    int offset;
+    /* set for a struct or boxed embedded by value */
+    GIBaseInfo *nested_info;
+    guint nested_is_simple : 1;
+    /* number or boolean stored in place, see field_get_direct() */
+    guint direct : 1;
+    guint readable : 1;
+    guint writable : 1;
+    GITypeTag tag;
+} BoxedField;
+
+typedef struct {
+    gsize size; /* of the struct */
+    int n_fields;
+    BoxedField *fields; /* indexed by the property TinyId */
+    GHashTable *fields_by_name; /* name => BoxedField* */
+} BoxedFields;
+
 typedef struct {
     GIBoxedInfo *info;
+    BoxedFields *fields; /* shared by all instances of the type */
     void *gboxed; /* NULL if we are the prototype and not an instance */
     guint can_allocate_directly : 1;
     guint allocated_directly : 1;
+    guint has_inline_storage : 1; /* fields->size bytes follow the struct */
+    guint gboxed_is_inline : 1;
     guint not_owning_gboxed : 1; /* if set, the JS wrapper does not own
                                     the reference to the C gboxed */
 } Boxed;
@@ -59,7 +87,7 @@ static gboolean struct_is_simple(GIStructInfo *info);
 
 static JSBool boxed_set_field_from_value(JSContext   *context,
                                          Boxed       *priv,
-                                         GIFieldInfo *field_info,
+                                         BoxedField  *field,
                                          jsval        value);
 
 static BoxedConstructInfo unthreadsafe_template_for_constructor = { NULL, NULL, JSVAL_NULL, FALSE };
@@ -192,6 +220,34 @@ boxed_get_copy_source(JSContext *context,
     return JS_TRUE;
 }
 
+/* Small simple structs are stored in the same allocation as the
+ * Boxed, right after it, when the wrapper owns a copy; that saves a
+ * second allocation per instance of types like rectangles, colors and
+ * points. sizeof(Boxed) is a multiple of the pointer size, which is
+ * all the alignment struct_is_simple() fields need.
+ */
+#define BOXED_INLINE_MAX_SIZE 64
+
+static Boxed*
+boxed_priv_new(gsize inline_size)
+{
+    Boxed *priv;
+
+    priv = g_slice_alloc0(sizeof(Boxed) + inline_size);
+    priv->has_inline_storage = inline_size > 0;
+
+    return priv;
+}
+
+static void
+boxed_priv_free(Boxed *priv)
+{
+    if (priv->has_inline_storage)
+        g_slice_free1(sizeof(Boxed) + priv->fields->size, priv);
+    else
+        g_slice_free(Boxed, priv);
+}
+
 static JSBool
 boxed_new_direct(JSContext   *context,
                  JSObject    *obj, /* "this" for constructor */
@@ -199,7 +255,12 @@ boxed_new_direct(JSContext   *context,
 {
     g_assert(priv->can_allocate_directly);
 
-    priv->gboxed = g_slice_alloc0(g_struct_info_get_size (priv->info));
+    if (priv->has_inline_storage) {
+        priv->gboxed = priv + 1;
+        priv->gboxed_is_inline = TRUE;
+    } else {
+        priv->gboxed = g_slice_alloc0(priv->fields->size);
+    }
     priv->allocated_directly = TRUE;
 
     gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
@@ -273,26 +334,87 @@ boxed_new(JSContext   *context,
     return JS_FALSE;
 }
 
-/* When initializing a boxed object from a hash of properties, we don't want
- * to do n O(n) lookups, so put temporarily put the fields into a hash table
- * for fast lookup. We could also do this ahead of time and store it on proto->priv.
+/* Field tables by "Namespace.Name"; like the info they are made from,
+ * they are never freed. Since gobject-introspection is always creating
+ * new info objects, the name is the only reliable key.
  */
-static GHashTable *
-get_field_map(GIStructInfo *struct_info)
+static GHashTable *boxed_fields_cache = NULL;
+
+static BoxedFields*
+get_boxed_fields(GIStructInfo *struct_info)
 {
-    GHashTable *result;
-    int n_fields;
+    BoxedFields *result;
+    char *key;
     int i;
 
-    result = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                   NULL, (GDestroyNotify)g_base_info_unref);
-    n_fields = g_struct_info_get_n_fields(struct_info);
+    key = g_strdup_printf("%s.%s",
+                          g_base_info_get_namespace((GIBaseInfo *)struct_info),
+                          g_base_info_get_name((GIBaseInfo *)struct_info));
 
-    for (i = 0; i < n_fields; i++) {
-        GIFieldInfo *field_info = g_struct_info_get_field(struct_info, i);
-        g_hash_table_insert(result, (char *)g_base_info_get_name((GIBaseInfo *)field_info), field_info);
+    if (boxed_fields_cache == NULL)
+        boxed_fields_cache = g_hash_table_new(g_str_hash, g_str_equal);
+
+    result = g_hash_table_lookup(boxed_fields_cache, key);
+    if (result != NULL) {
+        g_free(key);
+        return result;
+    }
+
+    result = g_slice_new0(BoxedFields);
+    result->size = g_struct_info_get_size(struct_info);
+    result->n_fields = g_struct_info_get_n_fields(struct_info);
+    result->fields = g_new0(BoxedField, result->n_fields);
+    result->fields_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (i = 0; i < result->n_fields; i++) {
+        BoxedField *field = &result->fields[i];
+
+        field->info = g_struct_info_get_field(struct_info, i);
+        field->type_info = g_field_info_get_type(field->info);
+        field->name = g_base_info_get_name((GIBaseInfo *)field->info);
+        field->offset = g_field_info_get_offset(field->info);
+        field->tag = g_type_info_get_tag(field->type_info);
+        field->readable = (g_field_info_get_flags(field->info) & GI_FIELD_IS_READABLE) != 0;
+        field->writable = (g_field_info_get_flags(field->info) & GI_FIELD_IS_WRITABLE) != 0;
+
+        if (!g_type_info_is_pointer(field->type_info)) {
+            switch (field->tag) {
+            case GI_TYPE_TAG_BOOLEAN:
+            case GI_TYPE_TAG_INT8:
+            case GI_TYPE_TAG_UINT8:
+            case GI_TYPE_TAG_INT16:
+            case GI_TYPE_TAG_UINT16:
+            case GI_TYPE_TAG_INT32:
+            case GI_TYPE_TAG_UINT32:
+            case GI_TYPE_TAG_INT64:
+            case GI_TYPE_TAG_UINT64:
+            case GI_TYPE_TAG_FLOAT:
+            case GI_TYPE_TAG_DOUBLE:
+                field->direct = TRUE;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (!g_type_info_is_pointer(field->type_info) &&
+            g_type_info_get_tag(field->type_info) == GI_TYPE_TAG_INTERFACE) {
+            GIBaseInfo *interface_info = g_type_info_get_interface(field->type_info);
+
+            if (g_base_info_get_type(interface_info) == GI_INFO_TYPE_STRUCT ||
+                g_base_info_get_type(interface_info) == GI_INFO_TYPE_BOXED) {
+                field->nested_info = interface_info;
+                field->nested_is_simple = struct_is_simple((GIStructInfo *)interface_info);
+            } else {
+                g_base_info_unref(interface_info);
+            }
+        }
+
+        g_hash_table_insert(result->fields_by_name, (char *)field->name, field);
     }
 
+    g_hash_table_insert(boxed_fields_cache, key, result);
+
     return result;
 }
 
@@ -309,7 +431,6 @@ boxed_init_from_props(JSContext   *context,
     JSObject *props;
     JSObject *iter;
     jsid prop_id;
-    GHashTable *field_map;
     gboolean success;
 
     success = FALSE;
@@ -327,22 +448,20 @@ boxed_init_from_props(JSContext   *context,
         return JS_FALSE;
     }
 
-    field_map = get_field_map(priv->info);
-
     prop_id = JSID_VOID;
     if (!JS_NextProperty(context, iter, &prop_id))
         goto out;
 
     while (!JSID_IS_VOID(prop_id)) {
-        GIFieldInfo *field_info;
+        BoxedField *field;
         char *name;
         jsval value;
 
         if (!gjs_get_string_id(context, prop_id, &name))
             goto out;
 
-        field_info = g_hash_table_lookup(field_map, name);
-        if (field_info == NULL) {
+        field = g_hash_table_lookup(priv->fields->fields_by_name, name);
+        if (field == NULL) {
             gjs_throw(context, "No field %s on boxed type %s",
                       name, g_base_info_get_name((GIBaseInfo *)priv->info));
             g_free(name);
@@ -355,7 +474,7 @@ boxed_init_from_props(JSContext   *context,
         }
         g_free(name);
 
-        if (!boxed_set_field_from_value(context, priv, field_info, value))
+        if (!boxed_set_field_from_value(context, priv, field, value))
             goto out;
 
         prop_id = JSID_VOID;
@@ -366,8 +485,6 @@ boxed_init_from_props(JSContext   *context,
     success = TRUE;
 
  out:
-    g_hash_table_destroy(field_map);
-
     return success;
 }
 
@@ -392,7 +509,7 @@ boxed_init(JSContext   *context,
             boxed_get_copy_source (context, priv, argv[0], &source_priv)) {
 
             memcpy(priv->gboxed, source_priv->gboxed,
-                   g_struct_info_get_size (priv->info));
+                   priv->fields->size);
 
             return JS_TRUE;
         }
@@ -423,20 +540,10 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
     JSClass *proto_class;
     JSObject *proto;
     gboolean is_proto;
+    gsize inline_size;
 
     GJS_NATIVE_CONSTRUCTOR_PRELUDE(boxed);
 
-    priv = g_slice_new0(Boxed);
-
-    GJS_INC_COUNTER(boxed);
-
-    g_assert(priv_from_js(context, object) == NULL);
-    JS_SetPrivate(context, object, priv);
-
-    gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
-                        "boxed constructor, obj %p priv %p",
-                        object, priv);
-
     proto = JS_GetPrototype(context, object);
     gjs_debug_lifecycle(GJS_DEBUG_GBOXED, "boxed instance __proto__ is %p", proto);
 
@@ -453,11 +560,9 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
                         "boxed instance constructing proto %d, obj class %s proto class %s",
                         is_proto, obj_class->name, proto_class->name);
 
+    proto_priv = NULL;
+    inline_size = 0;
     if (!is_proto) {
-        /* If we're the prototype, then post-construct we'll fill in priv->info.
-         * If we are not the prototype, though, then we'll get ->info from the
-         * prototype and then create a GObject if we don't have one already.
-         */
         proto_priv = priv_from_js(context, proto);
         if (proto_priv == NULL) {
             gjs_debug(GJS_DEBUG_GBOXED,
@@ -465,7 +570,50 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
             return JS_FALSE;
         }
 
+        /* Reserve inline storage only if the struct will be allocated
+         * directly; not if we are going to point into memory owned by
+         * someone else, or g_boxed_copy() a registered struct, be it
+         * one that C handed us or another instance we are
+         * copy-constructed from.
+         */
+        if (proto_priv->can_allocate_directly &&
+            proto_priv->fields->size <= BOXED_INLINE_MAX_SIZE) {
+            GType proto_gtype;
+            Boxed *copy_source;
+
+            proto_gtype = g_registered_type_info_get_g_type( (GIRegisteredTypeInfo*) proto_priv->info);
+
+            if (unthreadsafe_template_for_constructor.gboxed != NULL) {
+                if (JSVAL_IS_NULL(unthreadsafe_template_for_constructor.parent_jsval) &&
+                    !unthreadsafe_template_for_constructor.no_copy &&
+                    proto_gtype == G_TYPE_NONE)
+                    inline_size = proto_priv->fields->size;
+            } else if (proto_gtype == G_TYPE_NONE ||
+                       !(argc == 1 &&
+                         boxed_get_copy_source(context, proto_priv, argv[0], &copy_source))) {
+                inline_size = proto_priv->fields->size;
+            }
+        }
+    }
+
+    priv = boxed_priv_new(inline_size);
+
+    GJS_INC_COUNTER(boxed);
+
+    g_assert(priv_from_js(context, object) == NULL);
+    JS_SetPrivate(context, object, priv);
+
+    gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
+                        "boxed constructor, obj %p priv %p",
+                        object, priv);
+
+    if (!is_proto) {
+        /* If we're the prototype, then post-construct we'll fill in priv->info.
+         * If we are not the prototype, though, then we'll get ->info from the
+         * prototype and then create a GObject if we don't have one already.
+         */
         priv->info = proto_priv->info;
+        priv->fields = proto_priv->fields;
         priv->can_allocate_directly = proto_priv->can_allocate_directly;
         g_base_info_ref( (GIBaseInfo*) priv->info);
 
@@ -483,7 +631,9 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
         if (unthreadsafe_template_for_constructor.gboxed == NULL) {
             Boxed *source_priv;
 
-            /* Short-circuit copy-construction in the case where we can use g_boxed_copy */
+            /* Short-circuit copy-construction in the case where we can use
+             * g_boxed_copy(), or memcpy() for unregistered simple structs
+             */
             if (argc == 1 &&
                 boxed_get_copy_source(context, priv, argv[0], &source_priv)) {
 
@@ -492,6 +642,12 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
                     priv->gboxed = g_boxed_copy(gtype, source_priv->gboxed);
                     GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
                     return JS_TRUE;
+                } else if (priv->can_allocate_directly) {
+                    if (!boxed_new_direct(context, object, priv))
+                        return JS_FALSE;
+                    memcpy(priv->gboxed, source_priv->gboxed, priv->fields->size);
+                    GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
+                    return JS_TRUE;
                 }
             }
 
@@ -527,6 +683,10 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
             GType gtype = g_registered_type_info_get_g_type( (GIRegisteredTypeInfo*) priv->info);
             JSBool retval;
             
+            /* Registered types may be refcounted or have a copy
+             * function that does more than duplicate the visible
+             * fields, so only unregistered ones are copied by hand.
+             */
             if (gtype != G_TYPE_NONE) {
                 priv->gboxed = g_boxed_copy(gtype,
                                             unthreadsafe_template_for_constructor.gboxed);
@@ -536,7 +696,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
 
                 memcpy(priv->gboxed,
                        unthreadsafe_template_for_constructor.gboxed,
-                       g_struct_info_get_size (priv->info));
+                       priv->fields->size);
             } else {
                 gjs_throw(context,
                           "Can't create a Javascript object for %s; no way to copy",
@@ -570,8 +730,10 @@ boxed_finalize(JSContext *context,
         return; /* wrong class? */
 
     if (priv->gboxed && !priv->not_owning_gboxed) {
-        if (priv->allocated_directly) {
-            g_slice_free1(g_struct_info_get_size (priv->info), priv->gboxed);
+        if (priv->gboxed_is_inline) {
+            /* freed with priv */
+        } else if (priv->allocated_directly) {
+            g_slice_free1(priv->fields->size, priv->gboxed);
         } else {
             GType gtype = g_registered_type_info_get_g_type( (GIRegisteredTypeInfo*) priv->info);
             g_assert(gtype != G_TYPE_NONE);
@@ -588,19 +750,19 @@ boxed_finalize(JSContext *context,
     }
 
     GJS_DEC_COUNTER(boxed);
-    g_slice_free(Boxed, priv);
+    boxed_priv_free(priv);
 }
 
-static GIFieldInfo *
-get_field_info (JSContext *context,
-                Boxed     *priv,
-                jsid       id)
+static BoxedField *
+get_field (JSContext *context,
+           Boxed     *priv,
+           jsid       id)
 {
     int field_index;
     jsval id_val;
 
     if (!JS_IdToValue(context, id, &id_val))
-        return JS_FALSE;
+        return NULL;
 
     if (!JSVAL_IS_INT (id_val)) {
         gjs_throw(context, "Field index for %s is not an integer",
@@ -609,41 +771,37 @@ get_field_info (JSContext *context,
     }
 
     field_index = JSVAL_TO_INT(id_val);
-    if (field_index < 0 || field_index >= g_struct_info_get_n_fields (priv->info)) {
+    if (field_index < 0 || field_index >= priv->fields->n_fields) {
         gjs_throw(context, "Bad field index %d for %s", field_index,
                   g_base_info_get_name ((GIBaseInfo *)priv->info));
         return NULL;
     }
 
-    return g_struct_info_get_field (priv->info, field_index);
+    return &priv->fields->fields[field_index];
 }
 
 static JSBool
 get_nested_interface_object (JSContext   *context,
                              JSObject    *parent_obj,
                              Boxed       *parent_priv,
-                             GIFieldInfo *field_info,
-                             GITypeInfo  *type_info,
-                             GIBaseInfo  *interface_info,
+                             BoxedField  *field,
                              jsval       *value)
 {
     JSObject *obj;
     JSObject *proto;
-    int offset;
 
-    if (!struct_is_simple ((GIStructInfo *)interface_info)) {
+    if (!field->nested_is_simple) {
         gjs_throw(context, "Reading field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)parent_priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
+                  field->name);
 
         return JS_FALSE;
     }
 
-    proto = gjs_lookup_boxed_prototype(context, (GIBoxedInfo*) interface_info);
+    proto = gjs_lookup_boxed_prototype(context, (GIBoxedInfo*) field->nested_info);
 
-    offset = g_field_info_get_offset (field_info);
-    unthreadsafe_template_for_constructor.info = (GIBoxedInfo*) interface_info;
-    unthreadsafe_template_for_constructor.gboxed = ((char *)parent_priv->gboxed) + offset;
+    unthreadsafe_template_for_constructor.info = (GIBoxedInfo*) field->nested_info;
+    unthreadsafe_template_for_constructor.gboxed = ((char *)parent_priv->gboxed) + field->offset;
 
     /* Rooting the object here is a little paranoid; the JSObject has to be kept
      * alive anyways by our caller; so this would matter only if there was an
@@ -664,6 +822,134 @@ get_nested_interface_object (JSContext   *context,
     }
 }
 
+static inline JSBool
+int_to_jsval(JSContext *context,
+             double     v,
+             jsval     *value)
+{
+    if (v >= JSVAL_INT_MIN && v <= JSVAL_INT_MAX) {
+        *value = INT_TO_JSVAL((gint32) v);
+        return JS_TRUE;
+    }
+    return JS_NewNumberValue(context, v, value);
+}
+
+/* Reads a number or boolean field straight out of the struct, rather
+ * than through g_field_info_get_field() and gjs_value_from_g_argument().
+ */
+static JSBool
+field_get_direct(JSContext  *context,
+                 Boxed      *priv,
+                 BoxedField *field,
+                 jsval      *value)
+{
+    void *p = ((char *)priv->gboxed) + field->offset;
+
+    switch (field->tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+        *value = BOOLEAN_TO_JSVAL(*(gboolean *)p != FALSE);
+        return JS_TRUE;
+    case GI_TYPE_TAG_INT8:
+        *value = INT_TO_JSVAL(*(gint8 *)p);
+        return JS_TRUE;
+    case GI_TYPE_TAG_UINT8:
+        *value = INT_TO_JSVAL(*(guint8 *)p);
+        return JS_TRUE;
+    case GI_TYPE_TAG_INT16:
+        *value = INT_TO_JSVAL(*(gint16 *)p);
+        return JS_TRUE;
+    case GI_TYPE_TAG_UINT16:
+        *value = INT_TO_JSVAL(*(guint16 *)p);
+        return JS_TRUE;
+    case GI_TYPE_TAG_INT32:
+        return int_to_jsval(context, *(gint32 *)p, value);
+    case GI_TYPE_TAG_UINT32:
+        return int_to_jsval(context, *(guint32 *)p, value);
+    case GI_TYPE_TAG_INT64:
+        return int_to_jsval(context, *(gint64 *)p, value);
+    case GI_TYPE_TAG_UINT64:
+        return int_to_jsval(context, *(guint64 *)p, value);
+    case GI_TYPE_TAG_FLOAT:
+        return JS_NewNumberValue(context, *(gfloat *)p, value);
+    case GI_TYPE_TAG_DOUBLE:
+        return JS_NewNumberValue(context, *(gdouble *)p, value);
+    default:
+        g_assert_not_reached();
+        return JS_FALSE;
+    }
+}
+
+/* Writes a number or boolean field straight into the struct. Only
+ * handles values that need no conversion and are in range; returns
+ * FALSE for anything else, which then goes through the generic path
+ * to get its conversion and error reporting.
+ */
+static gboolean
+field_set_direct(JSContext  *context,
+                 Boxed      *priv,
+                 BoxedField *field,
+                 jsval       value)
+{
+    void *p = ((char *)priv->gboxed) + field->offset;
+    gint32 i;
+    double d;
+
+    if (field->tag == GI_TYPE_TAG_BOOLEAN) {
+        if (!JSVAL_IS_BOOLEAN(value))
+            return FALSE;
+        *(gboolean *)p = JSVAL_TO_BOOLEAN(value);
+        return TRUE;
+    }
+
+    if (field->tag == GI_TYPE_TAG_FLOAT || field->tag == GI_TYPE_TAG_DOUBLE) {
+        if (!JSVAL_IS_NUMBER(value) ||
+            !JS_ValueToNumber(context, value, &d))
+            return FALSE;
+
+        if (field->tag == GI_TYPE_TAG_DOUBLE) {
+            *(gdouble *)p = d;
+        } else {
+            if (d > G_MAXFLOAT || d < - G_MAXFLOAT)
+                return FALSE;
+            *(gfloat *)p = (gfloat) d;
+        }
+        return TRUE;
+    }
+
+    if (!JSVAL_IS_INT(value))
+        return FALSE;
+    i = JSVAL_TO_INT(value);
+
+#define STORE(ctype, in_range)          \
+    if (!(in_range))                    \
+        return FALSE;                   \
+    *(ctype *)p = (ctype) i;            \
+    return TRUE
+
+    switch (field->tag) {
+    case GI_TYPE_TAG_INT8:
+        STORE(gint8, i >= G_MININT8 && i <= G_MAXINT8);
+    case GI_TYPE_TAG_UINT8:
+        STORE(guint8, i >= 0 && i <= G_MAXUINT8);
+    case GI_TYPE_TAG_INT16:
+        STORE(gint16, i >= G_MININT16 && i <= G_MAXINT16);
+    case GI_TYPE_TAG_UINT16:
+        STORE(guint16, i >= 0 && i <= G_MAXUINT16);
+    case GI_TYPE_TAG_INT32:
+        STORE(gint32, TRUE);
+    case GI_TYPE_TAG_UINT32:
+        STORE(guint32, i >= 0);
+    case GI_TYPE_TAG_INT64:
+        STORE(gint64, TRUE);
+    case GI_TYPE_TAG_UINT64:
+        STORE(guint64, i >= 0);
+    default:
+        return FALSE;
+    }
+
+#undef STORE
+}
+
 static JSBool
 boxed_field_getter (JSContext *context,
                     JSObject  *obj,
@@ -671,91 +957,61 @@ boxed_field_getter (JSContext *context,
                     jsval     *value)
 {
     Boxed *priv;
-    GIFieldInfo *field_info;
-    GITypeInfo *type_info;
+    BoxedField *field;
     GArgument arg;
-    gboolean success = FALSE;
 
     priv = priv_from_js(context, obj);
     if (!priv)
         return JS_FALSE;
 
-    field_info = get_field_info(context, priv, id);
-    if (!field_info)
+    field = get_field(context, priv, id);
+    if (!field)
         return JS_FALSE;
 
-    type_info = g_field_info_get_type (field_info);
-
     if (priv->gboxed == NULL) { /* direct access to proto field */
         gjs_throw(context, "Can't get field %s.%s from a prototype",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
-        goto out;
+                  field->name);
+        return JS_FALSE;
     }
 
-    if (!g_type_info_is_pointer (type_info) &&
-        g_type_info_get_tag (type_info) == GI_TYPE_TAG_INTERFACE) {
-
-        GIBaseInfo *interface_info = g_type_info_get_interface(type_info);
+    if (field->direct && field->readable)
+        return field_get_direct (context, priv, field, value);
 
-        if (g_base_info_get_type (interface_info) == GI_INFO_TYPE_STRUCT ||
-            g_base_info_get_type (interface_info) == GI_INFO_TYPE_BOXED) {
+    if (field->nested_info != NULL)
+        return get_nested_interface_object (context, obj, priv, field, value);
 
-            success = get_nested_interface_object (context, obj, priv,
-                                                   field_info, type_info, interface_info,
-                                                   value);
-
-            g_base_info_unref ((GIBaseInfo *)interface_info);
-
-            goto out;
-        }
-
-        g_base_info_unref ((GIBaseInfo *)interface_info);
-    }
-
-    if (!g_field_info_get_field (field_info, priv->gboxed, &arg)) {
+    if (!g_field_info_get_field (field->info, priv->gboxed, &arg)) {
         gjs_throw(context, "Reading field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
-        goto out;
+                  field->name);
+        return JS_FALSE;
     }
 
-    if (!gjs_value_from_g_argument (context, value,
-                                    type_info,
-                                    &arg))
-        goto out;
-
-    success = TRUE;
-
-out:
-    g_base_info_unref ((GIBaseInfo *)field_info);
-    g_base_info_unref ((GIBaseInfo *)type_info);
-
-    return success;
+    return gjs_value_from_g_argument (context, value,
+                                      field->type_info,
+                                      &arg);
 }
 
 static JSBool
 set_nested_interface_object (JSContext   *context,
                              Boxed       *parent_priv,
-                             GIFieldInfo *field_info,
-                             GITypeInfo  *type_info,
-                             GIBaseInfo  *interface_info,
+                             BoxedField  *field,
                              jsval        value)
 {
     JSObject *proto;
-    int offset;
     Boxed *proto_priv;
     Boxed *source_priv;
 
-    if (!struct_is_simple ((GIStructInfo *)interface_info)) {
+    if (!field->nested_is_simple) {
         gjs_throw(context, "Writing field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)parent_priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
+                  field->name);
 
         return JS_FALSE;
     }
 
-    proto = gjs_lookup_boxed_prototype(context, (GIBoxedInfo*) interface_info);
+    proto = gjs_lookup_boxed_prototype(context, (GIBoxedInfo*) field->nested_info);
     proto_priv = priv_from_js(context, proto);
 
     /* If we can't directly copy from the source object we need
@@ -771,8 +1027,7 @@ set_nested_interface_object (JSContext   *context,
             return JS_FALSE;
     }
 
-    offset = g_field_info_get_offset (field_info);
-    memcpy(((char *)parent_priv->gboxed) + offset,
+    memcpy(((char *)parent_priv->gboxed) + field->offset,
            source_priv->gboxed,
            g_struct_info_get_size (source_priv->info));
 
@@ -782,63 +1037,40 @@ set_nested_interface_object (JSContext   *context,
 static JSBool
 boxed_set_field_from_value(JSContext   *context,
                            Boxed       *priv,
-                           GIFieldInfo *field_info,
+                           BoxedField  *field,
                            jsval        value)
 {
-    GITypeInfo *type_info;
     GArgument arg;
     gboolean success = FALSE;
-    gboolean need_release = FALSE;
-
-    type_info = g_field_info_get_type (field_info);
-
-    if (!g_type_info_is_pointer (type_info) &&
-        g_type_info_get_tag (type_info) == GI_TYPE_TAG_INTERFACE) {
-
-        GIBaseInfo *interface_info = g_type_info_get_interface(type_info);
-
-        if (g_base_info_get_type (interface_info) == GI_INFO_TYPE_STRUCT ||
-            g_base_info_get_type (interface_info) == GI_INFO_TYPE_BOXED) {
 
-            success = set_nested_interface_object (context, priv,
-                                                   field_info, type_info,
-                                                   interface_info, value);
-
-            g_base_info_unref ((GIBaseInfo *)interface_info);
-
-            goto out;
-        }
+    if (field->direct && field->writable &&
+        field_set_direct (context, priv, field, value))
+        return JS_TRUE;
 
-        g_base_info_unref ((GIBaseInfo *)interface_info);
-
-    }
+    if (field->nested_info != NULL)
+        return set_nested_interface_object (context, priv, field, value);
 
     if (!gjs_value_to_g_argument(context, value,
-                                 type_info,
-                                 g_base_info_get_name ((GIBaseInfo *)field_info),
+                                 field->type_info,
+                                 field->name,
                                  GJS_ARGUMENT_FIELD,
                                  GI_TRANSFER_NOTHING,
                                  TRUE, &arg))
-        goto out;
-
-    need_release = TRUE;
+        return JS_FALSE;
 
-    if (!g_field_info_set_field (field_info, priv->gboxed, &arg)) {
+    if (!g_field_info_set_field (field->info, priv->gboxed, &arg)) {
         gjs_throw(context, "Writing field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
+                  field->name);
         goto out;
     }
 
     success = TRUE;
 
 out:
-    if (need_release)
-        gjs_g_argument_release (context, GI_TRANSFER_NOTHING,
-                                type_info,
-                                &arg);
-
-    g_base_info_unref ((GIBaseInfo *)type_info);
+    gjs_g_argument_release (context, GI_TRANSFER_NOTHING,
+                            field->type_info,
+                            &arg);
 
     return success;
 }
@@ -853,30 +1085,24 @@ boxed_field_setter (JSContext *context,
                     jsval     *value)
 {
     Boxed *priv;
-    GIFieldInfo *field_info;
-    gboolean success = FALSE;
+    BoxedField *field;
 
     priv = priv_from_js(context, obj);
     if (!priv)
         return JS_FALSE;
 
-    field_info = get_field_info(context, priv, id);
-    if (!field_info)
+    field = get_field(context, priv, id);
+    if (!field)
         return JS_FALSE;
 
     if (priv->gboxed == NULL) { /* direct access to proto field */
         gjs_throw(context, "Can't set field %s.%s on prototype",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
-        goto out;
+                  field->name);
+        return JS_FALSE;
     }
 
-    success = boxed_set_field_from_value (context, priv, field_info, *value);
-
-out:
-    g_base_info_unref ((GIBaseInfo *)field_info);
-
-    return success;
+    return boxed_set_field_from_value (context, priv, field, *value);
 }
 
 static JSBool
@@ -884,7 +1110,7 @@ define_boxed_class_fields (JSContext *context,
                            Boxed     *priv,
                            JSObject  *proto)
 {
-    int n_fields = g_struct_info_get_n_fields (priv->info);
+    int n_fields = priv->fields->n_fields;
     int i;
 
     /* We identify properties with a 'TinyId': a 8-bit numeric value
@@ -915,18 +1141,10 @@ define_boxed_class_fields (JSContext *context,
     }
 
     for (i = 0; i < n_fields; i++) {
-        GIFieldInfo *field = g_struct_info_get_field (priv->info, i);
-        const char *field_name = g_base_info_get_name ((GIBaseInfo *)field);
-        gboolean result;
-
-        result = JS_DefinePropertyWithTinyId(context, proto, field_name, i,
-                                             JSVAL_NULL,
-                                             boxed_field_getter, boxed_field_setter,
-                                             JSPROP_PERMANENT | JSPROP_SHARED);
-
-        g_base_info_unref ((GIBaseInfo *)field);
-
-        if (!result)
+        if (!JS_DefinePropertyWithTinyId(context, proto, priv->fields->fields[i].name, i,
+                                         JSVAL_NULL,
+                                         boxed_field_getter, boxed_field_setter,
+                                         JSPROP_PERMANENT | JSPROP_SHARED))
             return JS_FALSE;
     }
 
@@ -1038,6 +1256,10 @@ struct_is_simple(GIStructInfo *info)
     gboolean is_simple = TRUE;
     int i;
 
+    /* If it's opaque, it's not simple */
+    if (n_fields == 0)
+        return FALSE;
+
     for (i = 0; i < n_fields && is_simple; i++) {
         GIFieldInfo *field_info = g_struct_info_get_field (info, i);
         GITypeInfo *type_info = g_field_info_get_type (field_info);
@@ -1203,6 +1425,7 @@ gjs_define_boxed_class(JSContext    *context,
               constructor_name, prototype, JS_GET_CLASS(context, prototype), in_object);
 
     priv->can_allocate_directly = struct_is_simple (priv->info);
+    priv->fields = get_boxed_fields (priv->info);
 
     define_boxed_class_fields (context, priv, prototype);
 
@@ -40,6 +40,9 @@ typedef struct {
     guint unref_on_global_object_finalized : 1;
 } Closure;
 
+/* innermost gjs_closure_begin_dispatch(), if any */
+static GjsClosureDispatch *current_dispatch = NULL;
+
 /*
  * Memory management of closures is "interesting" because we're keeping around
  * a JSContext* and then trying to use it spontaneously from the main loop.
@@ -236,6 +239,41 @@ closure_finalized(gpointer data,
     GJS_DEC_COUNTER(closure);
 }
 
+/**
+ * gjs_closure_begin_dispatch:
+ * @dispatch: caller-allocated dispatch state
+ * @context: the context to invoke closures in, normally the current one
+ *
+ * Enters a request on @context that closures of the same runtime
+ * invoked before gjs_closure_end_dispatch() will use directly, rather
+ * than each looking up the current context, checking that their own
+ * context still exists and entering a request of their own. Use this
+ * around code that may fire many closures, like a signal emission.
+ * Dispatches nest, and must be ended in reverse order.
+ */
+void
+gjs_closure_begin_dispatch(GjsClosureDispatch *dispatch,
+                           JSContext          *context)
+{
+    JS_BeginRequest(context);
+
+    dispatch->parent = current_dispatch;
+    dispatch->runtime = JS_GetRuntime(context);
+    dispatch->context = context;
+
+    current_dispatch = dispatch;
+}
+
+void
+gjs_closure_end_dispatch(GjsClosureDispatch *dispatch)
+{
+    g_assert(current_dispatch == dispatch);
+
+    current_dispatch = dispatch->parent;
+
+    JS_EndRequest(dispatch->context);
+}
+
 void
 gjs_closure_invoke(GClosure *closure,
                    int       argc,
@@ -244,10 +282,19 @@ gjs_closure_invoke(GClosure *closure,
 {
     Closure *c;
     JSContext *context;
+    GjsClosureDispatch *dispatch;
 
     c = (Closure*) closure;
 
-    check_context_valid(c);
+    dispatch = current_dispatch;
+    if (dispatch != NULL && dispatch->runtime == c->runtime) {
+        /* The dispatch's context is alive, we're running in it */
+        if (c->context != dispatch->context)
+            check_context_valid(c);
+    } else {
+        dispatch = NULL;
+        check_context_valid(c);
+    }
 
     if (c->obj == NULL) {
         /* We were destroyed; become a no-op */
@@ -255,36 +302,32 @@ gjs_closure_invoke(GClosure *closure,
         return;
     }
 
-    context = gjs_runtime_get_current_context(c->runtime);
-    JS_BeginRequest(context);
-
-    if (JS_IsExceptionPending(context)) {
-        gjs_debug_closure("Exception was pending before invoking callback??? "
-                          "Not expected");
-        gjs_log_exception(context, NULL);
+    if (dispatch != NULL) {
+        context = dispatch->context;
+    } else {
+        context = gjs_runtime_get_current_context(c->runtime);
+        JS_BeginRequest(context);
     }
 
-    if (!gjs_call_function_value(context,
-                                 NULL, /* "this" object; NULL is some kind of default presumably */
-                                 OBJECT_TO_JSVAL(c->obj),
-                                 argc,
-                                 argv,
-                                 retval)) {
+    /* Exceptions are only looked at when the call fails; if one were
+     * set while the call succeeded, the caller that set it reports it.
+     */
+    if (!JS_CallFunctionValue(context,
+                              NULL, /* "this" object; NULL is some kind of default presumably */
+                              OBJECT_TO_JSVAL(c->obj),
+                              argc,
+                              argv,
+                              retval)) {
         /* Exception thrown... */
         gjs_debug_closure("Closure invocation failed (exception should "
                           "have been thrown) closure %p callable %p",
                           closure, c->obj);
         if (!gjs_log_exception(context, NULL))
             gjs_debug_closure("Closure invocation failed but no exception was set?");
-        goto out;
     }
 
-    if (gjs_log_exception(context, NULL)) {
-        gjs_debug_closure("Closure invocation succeeded but an exception was set");
-    }
-
- out:
-    JS_EndRequest(context);
+    if (dispatch == NULL)
+        JS_EndRequest(context);
 }
 
 gboolean
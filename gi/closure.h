@@ -30,6 +30,17 @@
 
 G_BEGIN_DECLS
 
+/* Lets a run of closure invocations share one request and context;
+ * see gjs_closure_begin_dispatch(). Lives on the caller's stack.
+ */
+typedef struct _GjsClosureDispatch GjsClosureDispatch;
+struct _GjsClosureDispatch {
+    /*< private >*/
+    GjsClosureDispatch *parent;
+    JSRuntime *runtime;
+    JSContext *context;
+};
+
 GClosure*  gjs_closure_new           (JSContext    *context,
                                       JSObject     *callable,
                                       const char   *description);
@@ -41,6 +52,10 @@ JSRuntime* gjs_closure_get_runtime   (GClosure     *closure);
 gboolean   gjs_closure_is_valid      (GClosure     *closure);
 JSObject*  gjs_closure_get_callable  (GClosure     *closure);
 
+void       gjs_closure_begin_dispatch (GjsClosureDispatch *dispatch,
+                                       JSContext          *context);
+void       gjs_closure_end_dispatch   (GjsClosureDispatch *dispatch);
+
 G_END_DECLS
 
 #endif  /* __GJS_CLOSURE_H__ */
@@ -25,11 +25,13 @@
 
 #include "function.h"
 #include "arg.h"
+#include "arg-private.h"
 #include "object.h"
 #include "boxed.h"
 #include "union.h"
 #include <gjs/gjs-module.h>
 #include <gjs/compat.h>
+#include <gjs/profiler.h>
 
 #include <util/log.h>
 
@@ -47,6 +49,65 @@
  */
 #define GJS_ARG_INDEX_INVALID G_MAXUINT8
 
+/* Functions with at most this many C arguments (including the instance)
+ * can use the scalar invoker, which keeps its ffi arrays on the stack.
+ */
+#define GJS_SCALAR_INVOKE_MAX_ARGS 8
+
+/* Everything gjs_invoke_c_function() needs to know about an argument,
+ * computed once in init_cached_function_data() so that the invoke
+ * loop doesn't have to walk the typelib on every call. The arg_info
+ * and type_info are stack-style infos that stay valid as long as
+ * the owning Function holds its ref on the GIFunctionInfo.
+ */
+typedef struct {
+    GIArgInfo arg_info;
+    GITypeInfo type_info;
+    GIDirection direction;
+    GITypeTag type_tag;
+    GITransfer transfer;
+
+    /* For C arrays, the index of the argument holding the length */
+    guint8 array_length_index;
+    /* Position in the JS argv, GJS_ARG_INDEX_INVALID if not passed from JS */
+    guint8 js_argv_pos;
+    /* Position among the out and inout arguments, GJS_ARG_INDEX_INVALID
+     * for in arguments */
+    guint8 out_pos;
+
+    guint caller_allocates : 1;
+    /* Transfer-none in argument converted into the per-thread arena,
+     * see gjs_g_argument_can_use_arena(); never released */
+    guint use_arena : 1;
+    /* Size of the struct or union to allocate, 0 if unsupported */
+    gsize caller_allocates_size;
+} GjsArgPlan;
+
+/* Call statistics for one introspected function, recorded when
+ * GJS_DEBUG_GI_STATS is set; see gjs_init_cinvoke_profiling().
+ * Times are in microseconds; histogram bucket n counts calls that
+ * took less than 2^n microseconds, and the last bucket everything
+ * slower than that.
+ */
+#define GJS_CINVOKE_HISTOGRAM_BUCKETS 16
+
+typedef struct {
+    guint call_count;
+    gint64 total_time;
+    gint64 max_time;
+    guint histogram[GJS_CINVOKE_HISTOGRAM_BUCKETS];
+} GjsCInvokeCounters;
+
+typedef struct {
+    char *name;
+    /* Since startup, returned by imports.system.giStats() */
+    GjsCInvokeCounters total;
+    /* Since the previous profiler dump, which resets them */
+    GjsCInvokeCounters since_dump;
+} GjsCInvokeStats;
+
+typedef struct _GjsCallbackTrampolinePool GjsCallbackTrampolinePool;
+
 typedef struct {
     GIFunctionInfo *info;
 
@@ -59,15 +120,38 @@ typedef struct {
     guint8 js_out_argc;
     guint8 inout_argc;
     GIFunctionInvoker invoker;
+
+    /* The call plan; immutable after init_cached_function_data() */
+    guint8 n_args;
+    guint is_method : 1;
+    guint can_throw_gerror : 1;
+    /* Some argument has use_arena set */
+    guint uses_arena : 1;
+    GIInfoType container_type;
+    GITypeInfo return_info;
+    GITypeTag return_tag;
+    GITransfer return_transfer;
+    /* For C array return values, the index of the argument holding the length */
+    guint8 return_array_length_index;
+    GjsArgPlan *arg_plan;
+
+    GICallbackInfo *callback_info;
+    GIScopeType callback_scope;
+    GjsCallbackTrampolinePool *callback_pool;
+
+    /* Only scalar in args, no out args, callbacks, GError or transfer;
+     * see gjs_invoke_scalar_c_function()
+     */
+    guint scalar_only : 1;
+
+    /* NULL unless call statistics are enabled */
+    GjsCInvokeStats *stats;
 } Function;
 
 static struct JSClass gjs_function_class;
 
-/* Because we can't free the mmap'd data for a callback
- * while it's in use, this list keeps track of ones that
- * will be freed the next time we invoke a C function.
- */
-static GSList *completed_trampolines = NULL;  /* GjsCallbackTrampoline */
+/* "Namespace.Name" or "Namespace.Container.Name" => GjsCInvokeStats */
+static GHashTable *cinvoke_stats = NULL;
 
 static gboolean trampoline_globals_initialized = FALSE;
 static struct {
@@ -76,14 +160,40 @@ static struct {
     ffi_closure *closure;
 } global_destroy_trampoline;
 
-typedef struct {
+/* Number of idle trampolines we keep around per callback type when
+ * they are released from outside of the closure itself.
+ */
+#define GJS_TRAMPOLINE_POOL_MAX_FREE 16
+
+typedef struct _GjsCallbackTrampoline GjsCallbackTrampoline;
+
+/* Idle trampolines for one callback type, ready for reuse with their
+ * cif and closure already prepared. Pools are never freed, like the
+ * global destroy trampoline, but there is one per callback type at
+ * most; this also means a trampoline can always be put back in its pool
+ * from inside its own closure, where freeing the closure memory would
+ * not be safe. The pool is trimmed back to GJS_TRAMPOLINE_POOL_MAX_FREE
+ * the next time a trampoline is taken or released outside a closure.
+ */
+struct _GjsCallbackTrampolinePool {
+    GICallableInfo *info;
+    GjsCallbackTrampoline *free_list;
+    guint n_free;
+};
+
+struct _GjsCallbackTrampoline {
     JSRuntime *runtime;
     GICallableInfo *info;
     jsval js_function;
     ffi_cif cif;
     ffi_closure *closure;
     GIScopeType scope;
-} GjsCallbackTrampoline;
+    GjsCallbackTrampolinePool *pool;
+    GjsCallbackTrampoline *next_free;
+};
+
+/* "Namespace.Name" => GjsCallbackTrampolinePool */
+static GHashTable *trampoline_pools = NULL;
 
 GJS_DEFINE_PRIV_FROM_JS(Function, gjs_function_class)
 
@@ -128,15 +238,98 @@ function_new_resolve(JSContext *context,
 
 static void
 gjs_callback_trampoline_free(GjsCallbackTrampoline *trampoline)
+{
+    g_callable_info_free_closure(trampoline->info, trampoline->closure);
+    g_base_info_unref( (GIBaseInfo*) trampoline->info);
+    g_slice_free(GjsCallbackTrampoline, trampoline);
+}
+
+/* Frees idle trampolines above the cap; none of them is running, since
+ * trampolines released from their own closure are only added to the
+ * pool as the last thing the closure does.
+ */
+static void
+gjs_callback_trampoline_pool_trim(GjsCallbackTrampolinePool *pool)
+{
+    while (pool->n_free > GJS_TRAMPOLINE_POOL_MAX_FREE) {
+        GjsCallbackTrampoline *trampoline;
+
+        trampoline = pool->free_list;
+        pool->free_list = trampoline->next_free;
+        pool->n_free -= 1;
+
+        gjs_callback_trampoline_free(trampoline);
+    }
+}
+
+/* Drops the JS function and hands the trampoline back to its pool.
+ * @in_closure must be TRUE when called from the trampoline's own
+ * closure; in that case the closure can't be freed, so the trampoline
+ * always goes back to the pool even if it is full.
+ */
+static void
+gjs_callback_trampoline_release(GjsCallbackTrampoline *trampoline,
+                                gboolean               in_closure)
 {
     JSContext *context;
+    GjsCallbackTrampolinePool *pool;
 
     context = gjs_runtime_get_current_context(trampoline->runtime);
 
     JS_RemoveValueRoot(context, &trampoline->js_function);
-    g_callable_info_free_closure(trampoline->info, trampoline->closure);
-    g_base_info_unref( (GIBaseInfo*) trampoline->info);
-    g_slice_free(GjsCallbackTrampoline, trampoline);
+    trampoline->js_function = JSVAL_NULL;
+    trampoline->runtime = NULL;
+
+    pool = trampoline->pool;
+    if (in_closure) {
+        trampoline->next_free = pool->free_list;
+        pool->free_list = trampoline;
+        pool->n_free += 1;
+        return;
+    }
+
+    gjs_callback_trampoline_pool_trim(pool);
+
+    if (pool->n_free < GJS_TRAMPOLINE_POOL_MAX_FREE) {
+        trampoline->next_free = pool->free_list;
+        pool->free_list = trampoline;
+        pool->n_free += 1;
+    } else {
+        gjs_callback_trampoline_free(trampoline);
+    }
+}
+
+static GjsCallbackTrampolinePool*
+get_trampoline_pool(GICallableInfo *callable_info)
+{
+    GjsCallbackTrampolinePool *pool;
+    const char *name;
+    char *key;
+
+    /* Callback types referenced from arguments are named; if one
+     * isn't, it just gets a pool of its own. Looked up once per
+     * function, in init_cached_function_data().
+     */
+    name = g_base_info_get_name((GIBaseInfo*) callable_info);
+    if (name != NULL)
+        key = g_strdup_printf("%s.%s",
+                              g_base_info_get_namespace((GIBaseInfo*) callable_info),
+                              name);
+    else
+        key = g_strdup_printf("%p", callable_info);
+
+    pool = g_hash_table_lookup(trampoline_pools, key);
+    if (pool != NULL) {
+        g_free(key);
+        return pool;
+    }
+
+    pool = g_slice_new0(GjsCallbackTrampolinePool);
+    pool->info = callable_info;
+    g_base_info_ref((GIBaseInfo*) pool->info);
+    g_hash_table_insert(trampoline_pools, key, pool);
+
+    return pool;
 }
 
 /* This is our main entry point for ffi_closure callbacks.
@@ -222,7 +415,7 @@ out:
     }
 
     if (trampoline->scope == GI_SCOPE_TYPE_ASYNC) {
-        completed_trampolines = g_slist_prepend(completed_trampolines, trampoline);
+        gjs_callback_trampoline_release(trampoline, TRUE);
     }
 
     JS_EndRequest(context);
@@ -240,7 +433,7 @@ gjs_destroy_notify_callback_closure(ffi_cif *cif,
     GjsCallbackTrampoline *trampoline = *(void**)(args[0]);
 
     g_assert(trampoline);
-    gjs_callback_trampoline_free(trampoline);
+    gjs_callback_trampoline_release(trampoline, FALSE);
 }
 
 /* Called when we first see a function that uses a callback */
@@ -260,14 +453,16 @@ gjs_init_callback_statics ()
                                                                         &global_destroy_trampoline.cif,
                                                                         gjs_destroy_notify_callback_closure,
                                                                         NULL);
+
+    trampoline_pools = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static GjsCallbackTrampoline*
-gjs_callback_trampoline_new(JSContext      *context,
-                            jsval           function,
-                            GICallableInfo *callable_info,
-                            GIScopeType     scope,
-                            void          **destroy_notify)
+gjs_callback_trampoline_new(JSContext                 *context,
+                            jsval                      function,
+                            GjsCallbackTrampolinePool *pool,
+                            GIScopeType                scope,
+                            void                     **destroy_notify)
 {
     GjsCallbackTrampoline *trampoline;
 
@@ -278,14 +473,25 @@ gjs_callback_trampoline_new(JSContext      *context,
 
     g_assert(JS_TypeOfValue(context, function) == JSTYPE_FUNCTION);
 
-    trampoline = g_slice_new(GjsCallbackTrampoline);
+    if (pool->free_list != NULL) {
+        trampoline = pool->free_list;
+        pool->free_list = trampoline->next_free;
+        pool->n_free -= 1;
+
+        gjs_callback_trampoline_pool_trim(pool);
+    } else {
+        trampoline = g_slice_new(GjsCallbackTrampoline);
+        trampoline->pool = pool;
+        trampoline->info = pool->info;
+        g_base_info_ref((GIBaseInfo*)trampoline->info);
+        trampoline->closure = g_callable_info_prepare_closure(trampoline->info, &trampoline->cif,
+                                                              gjs_callback_closure, trampoline);
+    }
+    trampoline->next_free = NULL;
+
     trampoline->runtime = JS_GetRuntime(context);
-    trampoline->info = callable_info;
-    g_base_info_ref((GIBaseInfo*)trampoline->info);
     trampoline->js_function = function;
     JS_AddValueRoot(context, &trampoline->js_function);
-    trampoline->closure = g_callable_info_prepare_closure(callable_info, &trampoline->cif,
-                                                          gjs_callback_closure, trampoline);
 
     trampoline->scope = scope;
     if (scope == GI_SCOPE_TYPE_NOTIFIED) {
@@ -300,65 +506,79 @@ gjs_callback_trampoline_new(JSContext      *context,
 static JSBool
 init_callback_args_for_invocation(JSContext               *context,
                                   Function                *function,
-                                  guint8                   n_args,
                                   uintN                    js_argc,
                                   jsval                   *js_argv,
                                   GjsCallbackTrampoline  **trampoline_out,
                                   void                   **destroy_notify_out)
 {
-    GIArgInfo callback_arg;
-    GITypeInfo callback_type;
-    GITypeInfo *callback_info;
-    GIScopeType scope;
-    gboolean found_js_function;
+    GjsArgPlan *callback_plan;
     jsval js_function;
-    guint8 i, js_argv_pos;
 
     if (function->callback_index == GJS_ARG_INDEX_INVALID) {
         *trampoline_out = *destroy_notify_out = NULL;
         return JS_TRUE;
     }
 
-    g_callable_info_load_arg( (GICallableInfo*) function->info, function->callback_index, &callback_arg);
-    scope = g_arg_info_get_scope(&callback_arg);
-    g_arg_info_load_type(&callback_arg, &callback_type);
-    g_assert(g_type_info_get_tag(&callback_type) == GI_TYPE_TAG_INTERFACE);
-    callback_info = g_type_info_get_interface(&callback_type);
-    g_assert(g_base_info_get_type(callback_info) == GI_INFO_TYPE_CALLBACK);
+    callback_plan = &function->arg_plan[function->callback_index];
 
     /* Find the JS function passed for the callback */
-    found_js_function = FALSE;
-    js_function = JSVAL_NULL;
-    for (i = 0, js_argv_pos = 0; i < n_args; i++) {
-        if (i == function->callback_index) {
-            js_function = js_argv[js_argv_pos];
-            found_js_function = TRUE;
-            break;
-        } else if (i == function->user_data_index
-                   || i == function->destroy_notify_index) {
-            continue;
-        }
-        js_argv_pos++;
-    }
-
-    if (!found_js_function
-        || !(js_function == JSVAL_NULL || JS_TypeOfValue(context, js_function) == JSTYPE_FUNCTION)) {
+    if (callback_plan->js_argv_pos == GJS_ARG_INDEX_INVALID
+        || callback_plan->js_argv_pos >= js_argc
+        || !((js_function = js_argv[callback_plan->js_argv_pos]) == JSVAL_NULL
+             || JS_TypeOfValue(context, js_function) == JSTYPE_FUNCTION)) {
         gjs_throw(context, "Error invoking %s.%s: Invalid callback given for argument %s",
                   g_base_info_get_namespace( (GIBaseInfo*) function->info),
                   g_base_info_get_name( (GIBaseInfo*) function->info),
-                  g_base_info_get_name( (GIBaseInfo*) &callback_arg));
-        g_base_info_unref( (GIBaseInfo*) callback_info);
+                  g_base_info_get_name( (GIBaseInfo*) &callback_plan->arg_info));
         return JS_FALSE;
     }
 
     *trampoline_out = gjs_callback_trampoline_new(context, js_function,
-                                                  (GICallbackInfo*) callback_info,
-                                                  scope,
+                                                  function->callback_pool,
+                                                  function->callback_scope,
                                                   destroy_notify_out);
-    g_base_info_unref( (GIBaseInfo*) callback_info);
     return JS_TRUE;
 }
 
+/* Reads the length of a C array out of the argument at @length_index
+ * after the call; -1 if it isn't an integer argument.
+ */
+static int
+get_array_length(Function  *function,
+                 guint8     length_index,
+                 GArgument *in_arg_cvalues,
+                 GArgument *out_arg_cvalues)
+{
+    GjsArgPlan *plan = &function->arg_plan[length_index];
+    GArgument *arg;
+
+    if (plan->direction == GI_DIRECTION_IN)
+        arg = &in_arg_cvalues[length_index + (function->is_method ? 1 : 0)];
+    else
+        arg = &out_arg_cvalues[plan->out_pos];
+
+    switch (plan->type_tag) {
+    case GI_TYPE_TAG_INT8:
+        return arg->v_int8;
+    case GI_TYPE_TAG_UINT8:
+        return arg->v_uint8;
+    case GI_TYPE_TAG_INT16:
+        return arg->v_int16;
+    case GI_TYPE_TAG_UINT16:
+        return arg->v_uint16;
+    case GI_TYPE_TAG_INT32:
+        return arg->v_int32;
+    case GI_TYPE_TAG_UINT32:
+        return arg->v_uint32;
+    case GI_TYPE_TAG_INT64:
+        return arg->v_int64;
+    case GI_TYPE_TAG_UINT64:
+        return arg->v_uint64;
+    default:
+        return -1;
+    }
+}
+
 static JSBool
 gjs_invoke_c_function(JSContext      *context,
                       Function       *function,
@@ -392,34 +612,19 @@ gjs_invoke_c_function(JSContext      *context,
     GError *local_error = NULL;
     guint8 failed, postinvoke_release_failed;
 
-    GIFunctionInfoFlags flags;
     gboolean is_method;
-    GITypeInfo return_info;
     GITypeTag return_tag;
     jsval *return_values = NULL;
     guint8 next_rval = 0; /* index into return_values */
-    GSList *iter;
     GIScopeType callback_scope = GI_SCOPE_TYPE_INVALID;
     GjsCallbackTrampoline *callback_trampoline;
     void *destroy_notify;
+    GjsArena *arena = NULL;
+    GjsArenaMark arena_mark;
 
-    /* Because we can't free a closure while we're in it, we defer
-     * freeing until the next time a C function is invoked.  What
-     * we should really do instead is queue it for a GC thread.
-     */
-    if (completed_trampolines) {
-        for (iter = completed_trampolines; iter; iter = iter->next) {
-            GjsCallbackTrampoline *trampoline = iter->data;
-            gjs_callback_trampoline_free(trampoline);
-        }
-        g_slist_free(completed_trampolines);
-        completed_trampolines = NULL;
-    }
-
-    flags = g_function_info_get_flags(function->info);
-    is_method = (flags & GI_FUNCTION_IS_METHOD) != 0;
-    can_throw_gerror = (flags & GI_FUNCTION_THROWS) != 0;
-    n_args = g_callable_info_get_n_args( (GICallableInfo*) function->info);
+    is_method = function->is_method;
+    can_throw_gerror = function->can_throw_gerror;
+    n_args = function->n_args;
 
     /* We allow too many args; convenient for re-using a function as a callback.
      * But we don't allow too few args, since that would break.
@@ -437,15 +642,14 @@ gjs_invoke_c_function(JSContext      *context,
     /* Check if we have a callback; if so, process all the arguments (callback, destroy_notify, user_data)
      * at once to avoid having special cases in the main loop below.
      */
-    if (!init_callback_args_for_invocation(context, function, n_args, js_argc, js_argv,
+    if (!init_callback_args_for_invocation(context, function, js_argc, js_argv,
                                            &callback_trampoline, &destroy_notify)) {
         return JS_FALSE;
     }
     if (callback_trampoline != NULL)
         callback_scope = callback_trampoline->scope;
 
-    g_callable_info_load_return_type( (GICallableInfo*) function->info, &return_info);
-    return_tag = g_type_info_get_tag(&return_info);
+    return_tag = function->return_tag;
 
     in_args_len = function->invoker.cif.nargs;
     out_args_len = function->js_out_argc;
@@ -467,8 +671,7 @@ gjs_invoke_c_function(JSContext      *context,
     js_argv_pos = 0; /* index into argv */
 
     if (is_method) {
-        GIBaseInfo *container = g_base_info_get_container((GIBaseInfo *) function->info);
-        GIInfoType type = g_base_info_get_type(container);
+        GIInfoType type = function->container_type;
 
         g_assert_cmpuint(0, <, in_args_len);
 
@@ -483,17 +686,22 @@ gjs_invoke_c_function(JSContext      *context,
         ++in_args_pos;
     }
 
+    /* Transfer-none temporaries are taken from the arena and all
+     * dropped at once by rewinding it at the end of the call.
+     */
+    if (function->uses_arena) {
+        arena = gjs_arena_get_thread_default();
+        gjs_arena_get_mark(arena, &arena_mark);
+    }
+
     processed_in_args = in_args_pos;
     for (i = 0; i < n_args; i++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
+        GjsArgPlan *plan = &function->arg_plan[i];
+        GIDirection direction = plan->direction;
         gboolean arg_removed = FALSE;
 
         /* gjs_debug(GJS_DEBUG_GFUNCTION, "i: %d in_args_pos: %d argv_pos: %d", i, in_args_pos, js_argv_pos); */
 
-        g_callable_info_load_arg( (GICallableInfo*) function->info, i, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
         g_assert_cmpuint(in_args_pos, <, in_args_len);
         in_arg_pointers[in_args_pos] = &in_arg_cvalues[in_args_pos];
 
@@ -501,46 +709,15 @@ gjs_invoke_c_function(JSContext      *context,
             g_assert_cmpuint(out_args_pos, <, out_args_len);
             g_assert_cmpuint(in_args_pos, <, in_args_len);
 
-            if (g_arg_info_is_caller_allocates(&arg_info)) {
-                GITypeTag type_tag;
-                GITypeInfo ainfo;
-
-                g_arg_info_load_type(&arg_info, &ainfo);
-                type_tag = g_type_info_get_tag(&ainfo);
-
-                switch (type_tag) {
-                case GI_TYPE_TAG_INTERFACE:
-                    {
-                        GIBaseInfo* interface_info;
-                        GIInfoType interface_type;
-                        gsize size;
-
-                        interface_info = g_type_info_get_interface(&ainfo);
-                        g_assert(interface_info != NULL);
-
-                        interface_type = g_base_info_get_type(interface_info);
-
-                        if (interface_type == GI_INFO_TYPE_STRUCT) {
-                            size = g_struct_info_get_size((GIStructInfo*)interface_info);
-                        } else if (interface_type == GI_INFO_TYPE_UNION) {
-                            size = g_union_info_get_size((GIUnionInfo*)interface_info);
-                        } else {
-                            failed = TRUE;
-                        }
-
-                        g_base_info_unref((GIBaseInfo*)interface_info);
-
-                        if (!failed) {
-                            in_arg_cvalues[in_args_pos].v_pointer = g_slice_alloc0(size);
-                            out_arg_cvalues[out_args_pos].v_pointer = in_arg_cvalues[in_args_pos].v_pointer;
-                        }
-                        break;
-                    }
-                default:
+            if (plan->caller_allocates) {
+                if (plan->caller_allocates_size == 0) {
+                    gjs_throw(context, "Unsupported type %s for (out caller-allocates)",
+                              g_type_tag_to_string(plan->type_tag));
                     failed = TRUE;
+                } else {
+                    in_arg_cvalues[in_args_pos].v_pointer = g_slice_alloc0(plan->caller_allocates_size);
+                    out_arg_cvalues[out_args_pos].v_pointer = in_arg_cvalues[in_args_pos].v_pointer;
                 }
-                if (failed)
-                    gjs_throw(context, "Unsupported type %s for (out caller-allocates)", g_type_tag_to_string(type_tag));
             } else {
                 out_arg_cvalues[out_args_pos].v_pointer = NULL;
                 in_arg_cvalues[in_args_pos].v_pointer = &out_arg_cvalues[out_args_pos];
@@ -548,9 +725,6 @@ gjs_invoke_c_function(JSContext      *context,
             out_args_pos++;
         } else {
             GArgument *in_value;
-            GITypeInfo ainfo;
-
-            g_arg_info_load_type(&arg_info, &ainfo);
 
             g_assert_cmpuint(in_args_pos, <, in_args_len);
             in_value = &in_arg_cvalues[in_args_pos];
@@ -570,8 +744,20 @@ gjs_invoke_c_function(JSContext      *context,
             } else {
                 /* Ok, now just convert argument normally */
                 g_assert_cmpuint(js_argv_pos, <, js_argc);
-                if (!gjs_value_to_arg(context, js_argv[js_argv_pos], &arg_info,
-                                      in_value)) {
+                g_assert_cmpuint(js_argv_pos, ==, plan->js_argv_pos);
+                if (plan->use_arena) {
+                    if (!gjs_value_to_g_argument_in_arena(context, js_argv[js_argv_pos],
+                                                          &plan->type_info,
+                                                          g_base_info_get_name((GIBaseInfo*) &plan->arg_info),
+                                                          GJS_ARGUMENT_ARGUMENT,
+                                                          g_arg_info_may_be_null(&plan->arg_info),
+                                                          arena,
+                                                          in_value)) {
+                        failed = TRUE;
+                        break;
+                    }
+                } else if (!gjs_value_to_arg(context, js_argv[js_argv_pos], &plan->arg_info,
+                                             in_value)) {
                     failed = TRUE;
                     break;
                 }
@@ -646,16 +832,27 @@ gjs_invoke_c_function(JSContext      *context,
             gboolean arg_failed;
 
             g_assert_cmpuint(next_rval, <, function->js_out_argc);
-            arg_failed = !gjs_value_from_g_argument(context, &return_values[next_rval],
-                                                    &return_info, (GArgument*)&return_value);
+            if (function->return_array_length_index != GJS_ARG_INDEX_INVALID) {
+                arg_failed = !gjs_value_from_explicit_array(context, &return_values[next_rval],
+                                                            &function->return_info,
+                                                            (GArgument*)&return_value,
+                                                            get_array_length(function,
+                                                                             function->return_array_length_index,
+                                                                             in_arg_cvalues,
+                                                                             out_arg_cvalues));
+            } else {
+                arg_failed = !gjs_value_from_g_argument(context, &return_values[next_rval],
+                                                        &function->return_info,
+                                                        (GArgument*)&return_value);
+            }
             if (arg_failed)
                 failed = TRUE;
 
             /* Free GArgument, the jsval should have ref'd or copied it */
             if (!arg_failed &&
                 !gjs_g_argument_release(context,
-                                        g_callable_info_get_caller_owns((GICallableInfo*) function->info),
-                                        &return_info,
+                                        function->return_transfer,
+                                        &function->return_info,
                                         (GArgument*)&return_value))
                 failed = TRUE;
 
@@ -669,7 +866,7 @@ release:
      * callback was destroyed during the call.
      */
     if (callback_trampoline != NULL && callback_scope == GI_SCOPE_TYPE_CALL) {
-        gjs_callback_trampoline_free(callback_trampoline);
+        gjs_callback_trampoline_release(callback_trampoline, FALSE);
     }
 
     /* We walk over all args, release in args (if allocated) and convert
@@ -681,23 +878,21 @@ release:
 
     postinvoke_release_failed = FALSE;
     for (i = 0; i < n_args && in_args_pos < processed_in_args; i++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo arg_type_info;
-
-        g_callable_info_load_arg( (GICallableInfo*) function->info, i, &arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
-
-        g_arg_info_load_type(&arg_info, &arg_type_info);
+        GjsArgPlan *plan = &function->arg_plan[i];
+        GIDirection direction = plan->direction;
 
         if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT) {
             GArgument *arg;
             GITransfer transfer;
 
-            if (direction == GI_DIRECTION_IN) {
+            if (plan->use_arena) {
+                /* Freed with the arena below */
+                arg = NULL;
+                transfer = GI_TRANSFER_NOTHING;
+            } else if (direction == GI_DIRECTION_IN) {
                 g_assert_cmpuint(in_args_pos, <, in_args_len);
                 arg = &in_arg_cvalues[in_args_pos];
-                transfer = g_arg_info_get_ownership_transfer(&arg_info);
+                transfer = plan->transfer;
             } else {
                 g_assert_cmpuint(inout_args_pos, <, inout_args_len);
                 arg = &inout_original_arg_cvalues[inout_args_pos];
@@ -708,9 +903,10 @@ release:
                  */
                 transfer = GI_TRANSFER_EVERYTHING;
             }
-            if (!gjs_g_argument_release_in_arg(context,
+            if (arg != NULL &&
+                !gjs_g_argument_release_in_arg(context,
                                                transfer,
-                                               &arg_type_info,
+                                               &plan->type_info,
                                                arg)) {
                 postinvoke_release_failed = TRUE;
             }
@@ -734,14 +930,23 @@ release:
             g_assert_cmpuint(out_args_pos, <, out_args_len);
             arg = &out_arg_cvalues[out_args_pos];
 
-            arg_failed = FALSE;
-            if (!gjs_value_from_g_argument(context,
-                                           &return_values[next_rval],
-                                           &arg_type_info,
-                                           arg)) {
-                arg_failed = TRUE;
-                postinvoke_release_failed = TRUE;
+            if (plan->array_length_index != GJS_ARG_INDEX_INVALID) {
+                arg_failed = !gjs_value_from_explicit_array(context,
+                                                            &return_values[next_rval],
+                                                            &plan->type_info,
+                                                            arg,
+                                                            get_array_length(function,
+                                                                             plan->array_length_index,
+                                                                             in_arg_cvalues,
+                                                                             out_arg_cvalues));
+            } else {
+                arg_failed = !gjs_value_from_g_argument(context,
+                                                        &return_values[next_rval],
+                                                        &plan->type_info,
+                                                        arg);
             }
+            if (arg_failed)
+                postinvoke_release_failed = TRUE;
 
             /* For caller-allocates, what happens here is we allocate
              * a structure above, then gjs_value_from_g_argument calls
@@ -752,33 +957,17 @@ release:
              * this works OK.  We could also alloca() the structure instead
              * of slice allocating.
              */
-            if (g_arg_info_is_caller_allocates(&arg_info)) {
-                GITypeTag type_tag;
-                GIBaseInfo* interface_info;
-                GIInfoType interface_type;
-                gsize size;
-
-                type_tag = g_type_info_get_tag(&arg_type_info);
-                g_assert(type_tag == GI_TYPE_TAG_INTERFACE);
-                interface_info = g_type_info_get_interface(&arg_type_info);
-                interface_type = g_base_info_get_type(interface_info);
-                if (interface_type == GI_INFO_TYPE_STRUCT) {
-                    size = g_struct_info_get_size((GIStructInfo*)interface_info);
-                } else if (interface_type == GI_INFO_TYPE_UNION) {
-                    size = g_union_info_get_size((GIUnionInfo*)interface_info);
-                } else {
-                    g_assert_not_reached();
-                }
-
-                g_slice_free1(size, out_arg_cvalues[out_args_pos].v_pointer);
-                g_base_info_unref((GIBaseInfo*)interface_info);
+            if (plan->caller_allocates) {
+                g_assert(plan->caller_allocates_size != 0);
+                g_slice_free1(plan->caller_allocates_size,
+                              out_arg_cvalues[out_args_pos].v_pointer);
             }
 
             /* Free GArgument, the jsval should have ref'd or copied it */
             if (!arg_failed)
                 gjs_g_argument_release(context,
-                                       g_arg_info_get_ownership_transfer(&arg_info),
-                                       &arg_type_info,
+                                       plan->transfer,
+                                       &plan->type_info,
                                        arg);
 
             ++next_rval;
@@ -819,6 +1008,9 @@ release:
         gjs_unroot_value_locations(context, return_values, function->js_out_argc);
     }
 
+    if (arena != NULL)
+        gjs_arena_reset(arena, &arena_mark);
+
     if (!failed && did_throw_gerror) {
         gjs_throw(context, "Error invoking %s.%s: %s",
                   g_base_info_get_namespace( (GIBaseInfo*) function->info),
@@ -833,6 +1025,150 @@ release:
     }
 }
 
+/* Specialised version of gjs_invoke_c_function() for functions whose
+ * arguments are all scalars or GObjects passed in with no transfer,
+ * and which have no out arguments, callbacks or GError. Nothing
+ * converted on the way in needs to be released afterwards, so this
+ * skips the bookkeeping arrays and the release pass completely.
+ */
+static JSBool
+gjs_invoke_scalar_c_function(JSContext      *context,
+                             Function       *function,
+                             JSObject       *obj, /* "this" object */
+                             uintN           js_argc,
+                             jsval          *js_argv,
+                             jsval          *js_rval)
+{
+    GArgument in_arg_cvalues[GJS_SCALAR_INVOKE_MAX_ARGS];
+    gpointer in_arg_pointers[GJS_SCALAR_INVOKE_MAX_ARGS];
+    GArgument return_value;
+    guint8 i, in_args_pos;
+
+    if (js_argc < function->expected_js_argc) {
+        gjs_throw(context, "Too few arguments to %s %s.%s expected %d got %d",
+                  function->is_method ? "method" : "function",
+                  g_base_info_get_namespace( (GIBaseInfo*) function->info),
+                  g_base_info_get_name( (GIBaseInfo*) function->info),
+                  function->expected_js_argc,
+                  js_argc);
+        return JS_FALSE;
+    }
+
+    in_args_pos = 0;
+    if (function->is_method) {
+        GIInfoType type = function->container_type;
+
+        if (type == GI_INFO_TYPE_STRUCT || type == GI_INFO_TYPE_BOXED) {
+            in_arg_cvalues[0].v_pointer = gjs_c_struct_from_boxed(context, obj);
+        } else if (type == GI_INFO_TYPE_UNION) {
+            in_arg_cvalues[0].v_pointer = gjs_c_union_from_union(context, obj);
+        } else { /* by fallback is always object */
+            in_arg_cvalues[0].v_pointer = gjs_g_object_from_object(context, obj);
+        }
+        in_arg_pointers[0] = &in_arg_cvalues[0];
+        ++in_args_pos;
+    }
+
+    for (i = 0; i < function->n_args; i++, in_args_pos++) {
+        GjsArgPlan *plan = &function->arg_plan[i];
+        GArgument *in_value = &in_arg_cvalues[in_args_pos];
+        jsval value = js_argv[i];
+
+        in_arg_pointers[in_args_pos] = in_value;
+
+        /* Handle the common cases inline, and leave range checking and
+         * everything else to the general converter.
+         */
+        if (plan->type_tag == GI_TYPE_TAG_INT32 && JSVAL_IS_INT(value)) {
+            in_value->v_int = JSVAL_TO_INT(value);
+        } else if (plan->type_tag == GI_TYPE_TAG_DOUBLE && JSVAL_IS_INT(value)) {
+            in_value->v_double = JSVAL_TO_INT(value);
+        } else if (plan->type_tag == GI_TYPE_TAG_BOOLEAN && JSVAL_IS_BOOLEAN(value)) {
+            in_value->v_boolean = JSVAL_TO_BOOLEAN(value);
+        } else if (!gjs_value_to_arg(context, value, &plan->arg_info, in_value)) {
+            return JS_FALSE;
+        }
+    }
+
+    g_assert_cmpuint(in_args_pos, ==, (guint8)function->invoker.cif.nargs);
+
+    gjs_runtime_push_context(JS_GetRuntime(context), context);
+    ffi_call(&(function->invoker.cif), function->invoker.native_address, &return_value, in_arg_pointers);
+    gjs_runtime_pop_context(JS_GetRuntime(context));
+
+    if (function->return_tag == GI_TYPE_TAG_VOID) {
+        *js_rval = JSVAL_VOID;
+        return JS_TRUE;
+    }
+
+    return gjs_value_from_g_argument(context, js_rval,
+                                     &function->return_info,
+                                     &return_value);
+}
+
+static JSBool
+gjs_invoke_function_untimed(JSContext      *context,
+                            Function       *function,
+                            JSObject       *obj, /* "this" object */
+                            uintN           js_argc,
+                            jsval          *js_argv,
+                            jsval          *js_rval)
+{
+    if (function->scalar_only)
+        return gjs_invoke_scalar_c_function(context, function, obj, js_argc, js_argv, js_rval);
+    else
+        return gjs_invoke_c_function(context, function, obj, js_argc, js_argv, js_rval);
+}
+
+static void
+cinvoke_counters_add(GjsCInvokeCounters *counters,
+                     gint64              elapsed,
+                     guint               bucket)
+{
+    counters->call_count += 1;
+    counters->total_time += elapsed;
+    if (elapsed > counters->max_time)
+        counters->max_time = elapsed;
+    counters->histogram[bucket] += 1;
+}
+
+static void
+cinvoke_stats_record(GjsCInvokeStats *stats,
+                     gint64           elapsed)
+{
+    gint64 remaining;
+    guint bucket;
+
+    for (bucket = 0, remaining = elapsed;
+         remaining > 0 && bucket < GJS_CINVOKE_HISTOGRAM_BUCKETS - 1;
+         bucket++)
+        remaining >>= 1;
+
+    cinvoke_counters_add(&stats->total, elapsed, bucket);
+    cinvoke_counters_add(&stats->since_dump, elapsed, bucket);
+}
+
+static JSBool
+gjs_invoke_function(JSContext      *context,
+                    Function       *function,
+                    JSObject       *obj, /* "this" object */
+                    uintN           js_argc,
+                    jsval          *js_argv,
+                    jsval          *js_rval)
+{
+    gint64 start;
+    JSBool result;
+
+    if (G_LIKELY(function->stats == NULL))
+        return gjs_invoke_function_untimed(context, function, obj, js_argc, js_argv, js_rval);
+
+    start = JS_Now();
+    result = gjs_invoke_function_untimed(context, function, obj, js_argc, js_argv, js_rval);
+    cinvoke_stats_record(function->stats, JS_Now() - start);
+
+    return result;
+}
+
 #ifdef JSFUN_CONSTRUCTOR
 static JSBool
 function_call(JSContext *context,
@@ -867,16 +1203,35 @@ function_call(JSContext *context,
 #ifdef JSFUN_CONSTRUCTOR
     {
         jsval retval;
-        success = gjs_invoke_c_function(context, priv, object, js_argc, js_argv, &retval);
+        success = gjs_invoke_function(context, priv, object, js_argc, js_argv, &retval);
         if (success)
             JS_SET_RVAL(context, vp, retval);
     }
 #else
-    success = gjs_invoke_c_function(context, priv, object, js_argc, js_argv, retval);
+    success = gjs_invoke_function(context, priv, object, js_argc, js_argv, retval);
 #endif
     return success;
 }
 
+static Function*
+function_init_private(JSContext *context,
+                      JSObject  *object)
+{
+    Function *priv;
+
+    priv = g_slice_new0(Function);
+
+    GJS_INC_COUNTER(function);
+
+    g_assert(priv_from_js(context, object) == NULL);
+    JS_SetPrivate(context, object, priv);
+
+    gjs_debug_lifecycle(GJS_DEBUG_GFUNCTION,
+                        "function constructor, obj %p priv %p", object, priv);
+
+    return priv;
+}
+
 /* If we set JSCLASS_CONSTRUCT_PROTOTYPE flag, then this is called on
  * the prototype in addition to on each instance. When called on the
  * prototype, "obj" is the prototype, and "retval" is the prototype
@@ -907,17 +1262,8 @@ function_constructor(JSContext *context,
                      jsval     *retval)
 {
 #endif
-    Function *priv;
-
-    priv = g_slice_new0(Function);
+    function_init_private(context, object);
 
-    GJS_INC_COUNTER(function);
-
-    g_assert(priv_from_js(context, object) == NULL);
-    JS_SetPrivate(context, object, priv);
-
-    gjs_debug_lifecycle(GJS_DEBUG_GFUNCTION,
-                        "function constructor, obj %p priv %p", object, priv);
 #ifdef JSFUN_CONSTRUCTOR
     JS_SET_RVAL(context, vp, OBJECT_TO_JSVAL(object));
 #endif
@@ -933,6 +1279,9 @@ uninit_cached_function_data (Function *function)
 {
     if (function->info)
         g_base_info_unref( (GIBaseInfo*) function->info);
+    if (function->callback_info)
+        g_base_info_unref( (GIBaseInfo*) function->callback_info);
+    g_free(function->arg_plan);
     g_function_invoker_destroy(&function->invoker);
 }
 
@@ -982,53 +1331,334 @@ static struct JSClass gjs_function_class = {
     NULL, NULL, NULL, NULL, NULL
 };
 
+/* fn.callMany(argsArray) calls the C function once per element of
+ * argsArray, which must itself be an array of arguments; for methods
+ * the first element of each is the instance. Returns an array with the
+ * result of each call.
+ */
+static JSBool
+function_call_many(JSContext *context,
+                   uintN      js_argc,
+                   jsval     *vp)
+{
+    jsval *js_argv = JS_ARGV(context, vp);
+    JSObject *obj = JS_THIS_OBJECT(context, vp);
+    Function *priv;
+    JSObject *args_array;
+    JSObject *results;
+    jsuint n_calls, i;
+    jsval *call_argv;
+    guint call_argv_len, first_js_arg;
+    JSBool success;
+
+    priv = priv_from_js(context, obj);
+    if (priv == NULL) {
+        gjs_throw(context, "callMany() called on an object that is not a GIRepositoryFunction");
+        return JS_FALSE;
+    }
+
+    if (js_argc < 1 ||
+        !JSVAL_IS_OBJECT(js_argv[0]) ||
+        JSVAL_IS_NULL(js_argv[0]) ||
+        !JS_IsArrayObject(context, JSVAL_TO_OBJECT(js_argv[0]))) {
+        gjs_throw(context, "callMany() takes an array of argument arrays");
+        return JS_FALSE;
+    }
+
+    args_array = JSVAL_TO_OBJECT(js_argv[0]);
+    if (!JS_GetArrayLength(context, args_array, &n_calls))
+        return JS_FALSE;
+
+    results = JS_NewArrayObject(context, 0, NULL);
+    if (results == NULL)
+        return JS_FALSE;
+    /* vp is rooted, so this keeps the result array alive */
+    JS_SET_RVAL(context, vp, OBJECT_TO_JSVAL(results));
+
+    /* One scratch argv for the whole batch: the instance for methods,
+     * the JS arguments, and a last slot for the return value. Extra
+     * arguments are ignored by the invoker anyway, so we don't copy them.
+     */
+    first_js_arg = priv->is_method ? 1 : 0;
+    call_argv_len = first_js_arg + priv->expected_js_argc + 1;
+    call_argv = g_newa(jsval, call_argv_len);
+    gjs_set_values(context, call_argv, call_argv_len, JSVAL_VOID);
+    gjs_root_value_locations(context, call_argv, call_argv_len);
+
+    success = JS_FALSE;
+
+    for (i = 0; i < n_calls; i++) {
+        jsval entry;
+        JSObject *entry_obj;
+        JSObject *this_obj;
+        jsuint entry_len, j, n_copy;
+        jsval *rval = &call_argv[call_argv_len - 1];
+
+        if (!JS_GetElement(context, args_array, i, &entry))
+            goto out;
+
+        if (!JSVAL_IS_OBJECT(entry) ||
+            JSVAL_IS_NULL(entry) ||
+            !JS_IsArrayObject(context, JSVAL_TO_OBJECT(entry))) {
+            gjs_throw(context, "callMany(): element %d is not an array of arguments", i);
+            goto out;
+        }
+
+        entry_obj = JSVAL_TO_OBJECT(entry);
+        if (!JS_GetArrayLength(context, entry_obj, &entry_len))
+            goto out;
+
+        n_copy = MIN(entry_len, call_argv_len - 1);
+        for (j = 0; j < n_copy; j++) {
+            if (!JS_GetElement(context, entry_obj, j, &call_argv[j]))
+                goto out;
+        }
+
+        this_obj = NULL;
+        if (priv->is_method) {
+            if (n_copy < 1 ||
+                !JSVAL_IS_OBJECT(call_argv[0]) ||
+                JSVAL_IS_NULL(call_argv[0])) {
+                gjs_throw(context, "callMany(): element %d has no instance to call method %s on",
+                          i, g_base_info_get_name( (GIBaseInfo*) priv->info));
+                goto out;
+            }
+            this_obj = JSVAL_TO_OBJECT(call_argv[0]);
+        }
+
+        *rval = JSVAL_VOID;
+        if (!gjs_invoke_function(context, priv, this_obj,
+                                 n_copy - first_js_arg,
+                                 call_argv + first_js_arg,
+                                 rval))
+            goto out;
+
+        if (!JS_DefineElement(context, results, i, *rval,
+                              NULL, NULL, JSPROP_ENUMERATE))
+            goto out;
+    }
+
+    success = JS_TRUE;
+
+ out:
+    gjs_unroot_value_locations(context, call_argv, call_argv_len);
+    return success;
+}
+
 static JSPropertySpec gjs_function_proto_props[] = {
     { NULL }
 };
 
 static JSFunctionSpec gjs_function_proto_funcs[] = {
+    { "callMany", (JSNative)function_call_many, 0, JSFUN_FAST_NATIVE },
     { NULL }
 };
 
+static gsize
+get_caller_allocates_size(GITypeInfo *type_info)
+{
+    GIBaseInfo *interface_info;
+    GIInfoType interface_type;
+    gsize size;
+
+    if (g_type_info_get_tag(type_info) != GI_TYPE_TAG_INTERFACE)
+        return 0;
+
+    interface_info = g_type_info_get_interface(type_info);
+    g_assert(interface_info != NULL);
+
+    interface_type = g_base_info_get_type(interface_info);
+    if (interface_type == GI_INFO_TYPE_STRUCT) {
+        size = g_struct_info_get_size((GIStructInfo*)interface_info);
+    } else if (interface_type == GI_INFO_TYPE_UNION) {
+        size = g_union_info_get_size((GIUnionInfo*)interface_info);
+    } else {
+        size = 0;
+    }
+
+    g_base_info_unref(interface_info);
+
+    return size;
+}
+
+static gboolean
+type_is_scalar(GITypeInfo *type_info)
+{
+    GIBaseInfo *interface_info;
+    GIInfoType interface_type;
+
+    switch (g_type_info_get_tag(type_info)) {
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+    case GI_TYPE_TAG_GTYPE:
+        return TRUE;
+
+    case GI_TYPE_TAG_INTERFACE:
+        interface_info = g_type_info_get_interface(type_info);
+        interface_type = g_base_info_get_type(interface_info);
+        g_base_info_unref(interface_info);
+
+        return interface_type == GI_INFO_TYPE_ENUM ||
+            interface_type == GI_INFO_TYPE_FLAGS ||
+            interface_type == GI_INFO_TYPE_OBJECT ||
+            interface_type == GI_INFO_TYPE_INTERFACE;
+
+    default:
+        return FALSE;
+    }
+}
+
+/* Decides whether gjs_invoke_scalar_c_function() can be used */
+static gboolean
+function_is_scalar_only(Function *function)
+{
+    guint8 i;
+
+    if (function->can_throw_gerror ||
+        function->callback_index != GJS_ARG_INDEX_INVALID ||
+        function->destroy_notify_index != GJS_ARG_INDEX_INVALID ||
+        function->user_data_index != GJS_ARG_INDEX_INVALID ||
+        function->invoker.cif.nargs > GJS_SCALAR_INVOKE_MAX_ARGS)
+        return FALSE;
+
+    if (function->return_tag != GI_TYPE_TAG_VOID &&
+        (function->return_transfer != GI_TRANSFER_NOTHING ||
+         !type_is_scalar(&function->return_info)))
+        return FALSE;
+
+    for (i = 0; i < function->n_args; i++) {
+        GjsArgPlan *plan = &function->arg_plan[i];
+
+        if (plan->direction != GI_DIRECTION_IN ||
+            plan->transfer != GI_TRANSFER_NOTHING ||
+            !type_is_scalar(&plan->type_info))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static GjsCInvokeStats*
+get_cinvoke_stats(GIFunctionInfo *info)
+{
+    GjsCInvokeStats *stats;
+    GIBaseInfo *container;
+    char *name;
+
+    container = g_base_info_get_container((GIBaseInfo*) info);
+    if (container != NULL)
+        name = g_strdup_printf("%s.%s.%s",
+                               g_base_info_get_namespace((GIBaseInfo*) info),
+                               g_base_info_get_name(container),
+                               g_base_info_get_name((GIBaseInfo*) info));
+    else
+        name = g_strdup_printf("%s.%s",
+                               g_base_info_get_namespace((GIBaseInfo*) info),
+                               g_base_info_get_name((GIBaseInfo*) info));
+
+    stats = g_hash_table_lookup(cinvoke_stats, name);
+    if (stats != NULL) {
+        g_free(name);
+        return stats;
+    }
+
+    stats = g_slice_new0(GjsCInvokeStats);
+    stats->name = name;
+    g_hash_table_insert(cinvoke_stats, stats->name, stats);
+
+    return stats;
+}
+
 static gboolean
 init_cached_function_data (JSContext      *context,
                            Function       *function,
                            GIFunctionInfo *info)
 {
-    guint8 i, n_args;
+    guint8 i, n_args, js_argv_pos, out_pos;
     GError *error = NULL;
-    GITypeInfo return_type;
+    GIFunctionInfoFlags flags;
+
+    gjs_init_cinvoke_profiling();
 
     if (!g_function_info_prep_invoker(info, &(function->invoker), &error)) {
         gjs_throw_g_error(context, error);
         return FALSE;
     }
 
-    g_callable_info_load_return_type((GICallableInfo*)info, &return_type);
-    if (g_type_info_get_tag(&return_type) != GI_TYPE_TAG_VOID)
+    flags = g_function_info_get_flags(info);
+    function->is_method = (flags & GI_FUNCTION_IS_METHOD) != 0;
+    function->can_throw_gerror = (flags & GI_FUNCTION_THROWS) != 0;
+    if (function->is_method) {
+        GIBaseInfo *container = g_base_info_get_container((GIBaseInfo *) info);
+        function->container_type = g_base_info_get_type(container);
+    }
+
+    g_callable_info_load_return_type((GICallableInfo*)info, &function->return_info);
+    function->return_tag = g_type_info_get_tag(&function->return_info);
+    function->return_transfer = g_callable_info_get_caller_owns((GICallableInfo*) info);
+    if (function->return_tag != GI_TYPE_TAG_VOID)
       function->js_out_argc += 1;
 
     n_args = g_callable_info_get_n_args((GICallableInfo*) info);
+    function->n_args = n_args;
+    function->arg_plan = g_new0(GjsArgPlan, n_args);
+
+    function->return_array_length_index = GJS_ARG_INDEX_INVALID;
+    if (function->return_tag == GI_TYPE_TAG_ARRAY) {
+        int length_index = g_type_info_get_array_length(&function->return_info);
+        if (length_index >= 0 && length_index < n_args)
+            function->return_array_length_index = length_index;
+    }
 
     function->callback_index = GJS_ARG_INDEX_INVALID;
     function->destroy_notify_index = GJS_ARG_INDEX_INVALID;
     function->user_data_index = GJS_ARG_INDEX_INVALID;
 
     for (i = 0; i < n_args; i++) {
-        GIDirection direction;
-        GIArgInfo arg_info;
-        GITypeInfo type_info;
+        GjsArgPlan *plan = &function->arg_plan[i];
         guint8 destroy, closure;
-        GITypeTag type_tag;
 
-        g_callable_info_load_arg((GICallableInfo*) info, i, &arg_info);
-        g_arg_info_load_type(&arg_info, &type_info);
-        type_tag = g_type_info_get_tag(&type_info);
-        if (type_tag == GI_TYPE_TAG_INTERFACE) {
+        g_callable_info_load_arg((GICallableInfo*) info, i, &plan->arg_info);
+        g_arg_info_load_type(&plan->arg_info, &plan->type_info);
+        plan->type_tag = g_type_info_get_tag(&plan->type_info);
+        plan->direction = g_arg_info_get_direction(&plan->arg_info);
+        plan->transfer = g_arg_info_get_ownership_transfer(&plan->arg_info);
+        plan->js_argv_pos = GJS_ARG_INDEX_INVALID;
+
+        plan->array_length_index = GJS_ARG_INDEX_INVALID;
+        if (plan->type_tag == GI_TYPE_TAG_ARRAY) {
+            int length_index = g_type_info_get_array_length(&plan->type_info);
+            if (length_index >= 0 && length_index < n_args)
+                plan->array_length_index = length_index;
+        }
+
+        if (plan->direction == GI_DIRECTION_IN &&
+            plan->transfer == GI_TRANSFER_NOTHING &&
+            gjs_g_argument_can_use_arena(&plan->type_info)) {
+            plan->use_arena = TRUE;
+            function->uses_arena = TRUE;
+        }
+
+        if (plan->direction == GI_DIRECTION_OUT &&
+            g_arg_info_is_caller_allocates(&plan->arg_info)) {
+            plan->caller_allocates = TRUE;
+            plan->caller_allocates_size = get_caller_allocates_size(&plan->type_info);
+        }
+
+        if (plan->type_tag == GI_TYPE_TAG_INTERFACE) {
             GIBaseInfo* interface_info;
             GIInfoType interface_type;
 
-            interface_info = g_type_info_get_interface(&type_info);
+            interface_info = g_type_info_get_interface(&plan->type_info);
             interface_type = g_base_info_get_type(interface_info);
             if (interface_type == GI_INFO_TYPE_CALLBACK &&
                 i != function->destroy_notify_index) {
@@ -1040,13 +1670,16 @@ init_cached_function_data (JSContext      *context,
                     return FALSE;
                 }
                 function->callback_index = i;
+                function->callback_info = (GICallbackInfo*) interface_info;
+                function->callback_scope = g_arg_info_get_scope(&plan->arg_info);
+                g_base_info_ref(interface_info);
                 gjs_init_callback_statics();
+                function->callback_pool = get_trampoline_pool(function->callback_info);
             }
             g_base_info_unref(interface_info);
         }
-        destroy = g_arg_info_get_destroy(&arg_info);
-        closure = g_arg_info_get_closure(&arg_info);
-        direction = g_arg_info_get_direction(&arg_info);
+        destroy = g_arg_info_get_destroy(&plan->arg_info);
+        closure = g_arg_info_get_closure(&plan->arg_info);
 
         if (destroy > 0 && destroy < n_args) {
             function->expected_js_argc -= 1;
@@ -1068,14 +1701,32 @@ init_cached_function_data (JSContext      *context,
             function->user_data_index = closure;
         }
 
-        if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT)
+        if (plan->direction == GI_DIRECTION_IN || plan->direction == GI_DIRECTION_INOUT)
             function->expected_js_argc += 1;
-        if (direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT)
+        if (plan->direction == GI_DIRECTION_OUT || plan->direction == GI_DIRECTION_INOUT)
             function->js_out_argc += 1;
-        if (direction == GI_DIRECTION_INOUT)
+        if (plan->direction == GI_DIRECTION_INOUT)
             function->inout_argc += 1;
     }
 
+    /* Now that all the user_data and destroy notify slots are known,
+     * record where each remaining in argument comes from in the JS argv,
+     * and where each out argument's value is stored after the call.
+     */
+    for (i = 0, js_argv_pos = 0, out_pos = 0; i < n_args; i++) {
+        GjsArgPlan *plan = &function->arg_plan[i];
+
+        plan->out_pos = GJS_ARG_INDEX_INVALID;
+        if (plan->direction != GI_DIRECTION_IN)
+            plan->out_pos = out_pos++;
+
+        if (plan->direction == GI_DIRECTION_OUT ||
+            i == function->user_data_index ||
+            i == function->destroy_notify_index)
+            continue;
+
+        plan->js_argv_pos = js_argv_pos++;
+    }
 
     if (function->callback_index != GJS_ARG_INDEX_INVALID
         && function->destroy_notify_index != GJS_ARG_INDEX_INVALID
@@ -1086,6 +1737,11 @@ init_cached_function_data (JSContext      *context,
         return JS_FALSE;
     }
 
+    function->scalar_only = function_is_scalar_only(function);
+
+    if (cinvoke_stats != NULL)
+        function->stats = get_cinvoke_stats(info);
+
     function->info = info;
 
     g_base_info_ref((GIBaseInfo*) function->info);
@@ -1093,61 +1749,82 @@ init_cached_function_data (JSContext      *context,
     return TRUE;
 }
 
+/* Key of the per-runtime data holding the GIRepositoryFunction prototype.
+ * Like other class prototypes, it is kept alive by its constructor on the
+ * import global, which lives as long as the runtime.
+ */
+GJS_DEFINE_QUARK(gjs-gi-function-prototype, function_prototype)
+
 static JSObject*
-function_new(JSContext      *context,
-             GIFunctionInfo *info)
+get_function_prototype(JSContext *context)
 {
-    JSObject *function;
+    JSRuntime *runtime;
+    JSObject *prototype;
     JSObject *global;
-    Function *priv;
+
+    runtime = JS_GetRuntime(context);
+    prototype = gjs_runtime_get_data(runtime, function_prototype_quark());
+    if (G_LIKELY(prototype != NULL))
+        return prototype;
 
     /* put constructor for GIRepositoryFunction() in the global namespace */
     global = gjs_get_import_global(context);
 
-    if (!gjs_object_has_property(context, global, gjs_function_class.name)) {
-        JSObject *prototype;
-        JSObject *parent_proto;
-
-        parent_proto = NULL;
-
-        prototype = JS_InitClass(context, global,
-                                 /* parent prototype JSObject* for
-                                  * prototype; NULL for
-                                  * Object.prototype
-                                  */
-                                 parent_proto,
-                                 &gjs_function_class,
-                                 /* constructor for instances (NULL for
-                                  * none - just name the prototype like
-                                  * Math - rarely correct)
-                                  */
-                                 function_constructor,
-                                 /* number of constructor args */
-                                 0,
-                                 /* props of prototype */
-                                 &gjs_function_proto_props[0],
-                                 /* funcs of prototype */
-                                 &gjs_function_proto_funcs[0],
-                                 /* props of constructor, MyConstructor.myprop */
-                                 NULL,
-                                 /* funcs of constructor, MyConstructor.myfunc() */
-                                 NULL);
-        if (prototype == NULL)
-            gjs_fatal("Can't init class %s", gjs_function_class.name);
-
-        g_assert(gjs_object_has_property(context, global, gjs_function_class.name));
-
-        gjs_debug(GJS_DEBUG_GFUNCTION, "Initialized class %s prototype %p",
-                  gjs_function_class.name, prototype);
-    }
+    prototype = JS_InitClass(context, global,
+                             /* parent prototype JSObject* for
+                              * prototype; NULL for
+                              * Object.prototype
+                              */
+                             NULL,
+                             &gjs_function_class,
+                             /* constructor for instances (NULL for
+                              * none - just name the prototype like
+                              * Math - rarely correct)
+                              */
+                             function_constructor,
+                             /* number of constructor args */
+                             0,
+                             /* props of prototype */
+                             &gjs_function_proto_props[0],
+                             /* funcs of prototype */
+                             &gjs_function_proto_funcs[0],
+                             /* props of constructor, MyConstructor.myprop */
+                             NULL,
+                             /* funcs of constructor, MyConstructor.myfunc() */
+                             NULL);
+    if (prototype == NULL)
+        gjs_fatal("Can't init class %s", gjs_function_class.name);
+
+    gjs_runtime_set_data(runtime, function_prototype_quark(), prototype, NULL);
+
+    gjs_debug(GJS_DEBUG_GFUNCTION, "Initialized class %s prototype %p",
+              gjs_function_class.name, prototype);
+
+    return prototype;
+}
+
+static JSObject*
+function_new(JSContext      *context,
+             GIFunctionInfo *info)
+{
+    JSObject *function;
+    JSObject *prototype;
+    Function *priv;
+
+    prototype = get_function_prototype(context);
 
-    function = JS_ConstructObject(context, &gjs_function_class, NULL, global);
+    /* Create the instance directly from the cached prototype rather than
+     * with JS_ConstructObject(), which would look the constructor up on
+     * the global again.
+     */
+    function = JS_NewObject(context, &gjs_function_class, prototype,
+                            gjs_get_import_global(context));
     if (function == NULL) {
         gjs_debug(GJS_DEBUG_GFUNCTION, "Failed to construct function");
         return NULL;
     }
 
-    priv = priv_from_js(context, function);
+    priv = function_init_private(context, function);
     if (!init_cached_function_data(context, priv, info))
       return NULL;
 
@@ -1187,6 +1864,38 @@ gjs_define_function(JSContext      *context,
 }
 
 
+/* Namespaces listed in the GJS_EAGER_DEFINE environment variable
+ * (comma-separated, or "*" for all of them) get all of a class's
+ * methods defined in bulk when its prototype is first resolved,
+ * rather than one by one as they are looked up.
+ */
+gboolean
+gjs_function_define_eagerly(const char *ns_name)
+{
+    static gboolean initialized = FALSE;
+    static char **eager_namespaces = NULL;
+    int i;
+
+    if (G_UNLIKELY(!initialized)) {
+        const char *env = g_getenv("GJS_EAGER_DEFINE");
+
+        if (env != NULL && *env != '\0')
+            eager_namespaces = g_strsplit(env, ",", -1);
+        initialized = TRUE;
+    }
+
+    if (G_LIKELY(eager_namespaces == NULL))
+        return FALSE;
+
+    for (i = 0; eager_namespaces[i] != NULL; i++) {
+        if (strcmp(eager_namespaces[i], "*") == 0 ||
+            strcmp(eager_namespaces[i], ns_name) == 0)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 JSBool
 gjs_invoke_c_function_uncached (JSContext      *context,
                                 GIFunctionInfo *info,
@@ -1202,7 +1911,160 @@ gjs_invoke_c_function_uncached (JSContext      *context,
   if (!init_cached_function_data (context, &function, info))
     return JS_FALSE;
 
-  result = gjs_invoke_c_function (context, &function, obj, argc, argv, rval);
+  result = gjs_invoke_function (context, &function, obj, argc, argv, rval);
   uninit_cached_function_data (&function);
   return result;
 }
+
+static void
+dump_cinvoke_stats_one(gpointer key,
+                       gpointer value,
+                       gpointer user_data)
+{
+    GjsCInvokeStats *stats = value;
+    GjsCInvokeCounters *counters = &stats->since_dump;
+    FILE *fp = user_data;
+    guint i;
+
+    if (counters->call_count == 0)
+        return;
+
+    /* function calls total max histogram */
+    fprintf(fp, "%s\t%u\t%.2f\t%.2f\t",
+            stats->name,
+            counters->call_count,
+            counters->total_time / 1000.,
+            counters->max_time / 1000.);
+    for (i = 0; i < GJS_CINVOKE_HISTOGRAM_BUCKETS; i++)
+        fprintf(fp, i == 0 ? "%u" : ",%u", counters->histogram[i]);
+    fprintf(fp, "\n");
+
+    /* reset counters so that next dump is delta from previous;
+     * the totals seen by giStats() keep counting
+     */
+    memset(counters, 0, sizeof(*counters));
+}
+
+static void
+dump_cinvoke_stats(FILE *fp,
+                   void *data)
+{
+    fprintf(fp, "function\tcalls\ttotal\tmax\thistogram\n");
+
+    g_hash_table_foreach(cinvoke_stats,
+                         dump_cinvoke_stats_one,
+                         fp);
+}
+
+/* Enables per-function call statistics if GJS_DEBUG_GI_STATS is set.
+ * They are appended to each profiler dump, and can be read from JS
+ * with imports.system.giStats().
+ */
+void
+gjs_init_cinvoke_profiling(void)
+{
+    static gboolean initialized = FALSE;
+
+    if (G_LIKELY(initialized))
+        return;
+    initialized = TRUE;
+
+    if (g_getenv("GJS_DEBUG_GI_STATS") == NULL)
+        return;
+
+    cinvoke_stats = g_hash_table_new(g_str_hash, g_str_equal);
+    gjs_profiler_add_dump_func(dump_cinvoke_stats, NULL);
+}
+
+static JSBool
+cinvoke_stats_to_js(JSContext          *context,
+                    GjsCInvokeCounters *counters,
+                    JSObject           *stats_obj)
+{
+    jsval histogram[GJS_CINVOKE_HISTOGRAM_BUCKETS];
+    JSObject *histogram_obj;
+    jsval value;
+    guint i;
+
+    for (i = 0; i < GJS_CINVOKE_HISTOGRAM_BUCKETS; i++)
+        histogram[i] = INT_TO_JSVAL(MIN(counters->histogram[i], JSVAL_INT_MAX));
+
+    histogram_obj = JS_NewArrayObject(context, GJS_CINVOKE_HISTOGRAM_BUCKETS, histogram);
+    if (histogram_obj == NULL ||
+        !JS_DefineProperty(context, stats_obj, "histogram",
+                           OBJECT_TO_JSVAL(histogram_obj),
+                           NULL, NULL, JSPROP_ENUMERATE))
+        return JS_FALSE;
+
+    if (!JS_NewNumberValue(context, counters->call_count, &value) ||
+        !JS_DefineProperty(context, stats_obj, "calls", value,
+                           NULL, NULL, JSPROP_ENUMERATE))
+        return JS_FALSE;
+
+    if (!JS_NewNumberValue(context, counters->total_time / 1000., &value) ||
+        !JS_DefineProperty(context, stats_obj, "totalTime", value,
+                           NULL, NULL, JSPROP_ENUMERATE))
+        return JS_FALSE;
+
+    if (!JS_NewNumberValue(context, counters->max_time / 1000., &value) ||
+        !JS_DefineProperty(context, stats_obj, "maxTime", value,
+                           NULL, NULL, JSPROP_ENUMERATE))
+        return JS_FALSE;
+
+    return JS_TRUE;
+}
+
+/* Returns an object mapping function names to their call statistics
+ * since startup, times in milliseconds; unlike the profiler dump, these
+ * are not reset. The object is empty if statistics aren't enabled.
+ */
+JSBool
+gjs_get_cinvoke_stats(JSContext *context,
+                      jsval     *value_p)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    JSObject *obj;
+    JSObject *stats_obj;
+    JSBool result;
+
+    obj = JS_NewObject(context, NULL, NULL, NULL);
+    if (obj == NULL)
+        return JS_FALSE;
+
+    *value_p = OBJECT_TO_JSVAL(obj);
+    if (cinvoke_stats == NULL)
+        return JS_TRUE;
+
+    JS_AddObjectRoot(context, &obj);
+
+    result = JS_FALSE;
+
+    g_hash_table_iter_init(&iter, cinvoke_stats);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        GjsCInvokeStats *stats = value;
+
+        if (stats->total.call_count == 0)
+            continue;
+
+        stats_obj = JS_NewObject(context, NULL, NULL, NULL);
+        if (stats_obj == NULL)
+            goto out;
+
+        /* Define it first so it's rooted through obj */
+        if (!JS_DefineProperty(context, obj, stats->name,
+                               OBJECT_TO_JSVAL(stats_obj),
+                               NULL, NULL, JSPROP_ENUMERATE))
+            goto out;
+
+        if (!cinvoke_stats_to_js(context, &stats->total, stats_obj))
+            goto out;
+    }
+
+    result = JS_TRUE;
+
+ out:
+    JS_RemoveObjectRoot(context, &obj);
+
+    return result;
+}
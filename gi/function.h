@@ -41,8 +41,11 @@ JSBool    gjs_invoke_c_function_uncached (JSContext      *context,
                                           uintN           argc,
                                           jsval          *argv,
                                           jsval          *rval);
+gboolean  gjs_function_define_eagerly (const char *ns_name);
 
-void     gjs_init_cinvoke_profiling ();
+void     gjs_init_cinvoke_profiling (void);
+JSBool   gjs_get_cinvoke_stats      (JSContext      *context,
+                                     jsval          *value_p);
 
 G_END_DECLS
 
@@ -27,9 +27,9 @@
 
 #include <gjs/gjs-module.h>
 #include <gjs/compat.h>
+#include <gjs/profiler.h>
 
 #include <util/log.h>
-#include <util/glib.h>
 
 #include <jsapi.h>
 
@@ -39,45 +39,218 @@ typedef struct {
     void *data;
 } Child;
 
+/* Children are stored by value in a dense array, so tracing is a
+ * linear walk, and indexed by an open-addressed hash table of array
+ * positions (plus one; zero is an empty slot) with linear probing, so
+ * adding and removing are O(1). Removal moves the last child into the
+ * hole, keeping the array dense.
+ */
 typedef struct {
-    GHashTable *children;
+    Child *children;
+    guint n_children;
+    guint n_allocated;
+    guint *slots;
+    guint slot_mask; /* number of slots - 1, slots are a power of 2 */
+    char *shard; /* name, for the keep-alives on the import global */
+    guint n_traces;
+    gint64 trace_time; /* usec, only measured with GJS_DEBUG_GI_STATS */
     unsigned int inside_finalize : 1;
     unsigned int inside_trace : 1;
 } KeepAlive;
 
+#define KEEP_ALIVE_MIN_SLOTS 16
+
 static struct JSClass gjs_keep_alive_class;
 
 GJS_DEFINE_PRIV_FROM_JS(KeepAlive, gjs_keep_alive_class)
 
+/* Dumped with the profiler data if GJS_DEBUG_GI_STATS is set */
+static struct {
+    gboolean enabled;
+    guint keep_alives;
+    guint children;
+    guint peak_children;
+    guint added;
+    guint removed;
+    GSList *shards; /* KeepAlive with a shard name */
+} keep_alive_stats;
+
+static void
+dump_keep_alive_stats(FILE *fp,
+                      void *data)
+{
+    GSList *l;
+
+    fprintf(fp, "keep-alive: %u children in %u keep-alives (peak %u), %u added, %u removed\n",
+            keep_alive_stats.children,
+            keep_alive_stats.keep_alives,
+            keep_alive_stats.peak_children,
+            keep_alive_stats.added,
+            keep_alive_stats.removed);
+
+    /* which shards the GC spends its time marking */
+    for (l = keep_alive_stats.shards; l != NULL; l = l->next) {
+        KeepAlive *priv = l->data;
+
+        fprintf(fp, "keep-alive shard %s: %u children, traced %u times in %.3f ms\n",
+                priv->shard,
+                priv->n_children,
+                priv->n_traces,
+                priv->trace_time / 1000.0);
+
+        priv->n_traces = 0;
+        priv->trace_time = 0;
+    }
+
+    /* reset counters so that next dump is delta from previous */
+    keep_alive_stats.peak_children = keep_alive_stats.children;
+    keep_alive_stats.added = 0;
+    keep_alive_stats.removed = 0;
+}
+
+static void
+init_keep_alive_stats(void)
+{
+    static gboolean initialized = FALSE;
+
+    if (initialized)
+        return;
+    initialized = TRUE;
+
+    if (g_getenv("GJS_DEBUG_GI_STATS") != NULL) {
+        keep_alive_stats.enabled = TRUE;
+        gjs_profiler_add_dump_func(dump_keep_alive_stats, NULL);
+    }
+}
+
 static guint
-child_hash(gconstpointer  v)
+child_hash(GjsUnrootedFunc  notify,
+           JSObject        *obj,
+           void            *data)
 {
-    const Child *child = v;
+    guint hash;
 
-    return
-        GPOINTER_TO_UINT(child->notify) ^
-        GPOINTER_TO_UINT(child->child) ^
-        GPOINTER_TO_UINT(child->data);
+    hash =
+        GPOINTER_TO_UINT(notify) ^
+        GPOINTER_TO_UINT(obj) ^
+        GPOINTER_TO_UINT(data);
+
+    /* the low bits pick the slot, and pointers have none to spare */
+    return hash ^ (hash >> 4) ^ (hash >> 12);
 }
 
 static gboolean
-child_equal (gconstpointer  v1,
-             gconstpointer  v2)
+child_equal(const Child     *child,
+            GjsUnrootedFunc  notify,
+            JSObject        *obj,
+            void            *data)
 {
-    const Child *child1 = v1;
-    const Child *child2 = v2;
-
     /* notify is most likely to be equal, so check it last */
-    return child1->data == child2->data &&
-        child1->child == child2->child &&
-        child1->notify == child2->notify;
+    return child->data == data &&
+        child->child == obj &&
+        child->notify == notify;
+}
+
+/* Returns the slot holding the child, or the empty slot it would go in */
+static guint
+find_slot(KeepAlive       *priv,
+          GjsUnrootedFunc  notify,
+          JSObject        *obj,
+          void            *data)
+{
+    guint i;
+
+    i = child_hash(notify, obj, data) & priv->slot_mask;
+
+    while (priv->slots[i] != 0) {
+        if (child_equal(&priv->children[priv->slots[i] - 1], notify, obj, data))
+            break;
+        i = (i + 1) & priv->slot_mask;
+    }
+
+    return i;
+}
+
+static void
+resize_slots(KeepAlive *priv,
+             guint      n_slots)
+{
+    guint i;
+
+    g_free(priv->slots);
+    priv->slots = g_new0(guint, n_slots);
+    priv->slot_mask = n_slots - 1;
+
+    for (i = 0; i < priv->n_children; i++) {
+        Child *child = &priv->children[i];
+        guint slot;
+
+        slot = find_slot(priv, child->notify, child->child, child->data);
+        priv->slots[slot] = i + 1;
+    }
 }
 
 static void
-child_free(void *data)
+remove_slot(KeepAlive *priv,
+            guint      slot)
 {
-    Child *child = data;
-    g_slice_free(Child, child);
+    guint next;
+
+    /* Shift back the entries after the removed one that would no
+     * longer be found past the hole, so no tombstones are needed.
+     */
+    next = slot;
+    while (TRUE) {
+        Child *child;
+        guint home;
+
+        next = (next + 1) & priv->slot_mask;
+        if (priv->slots[next] == 0)
+            break;
+
+        child = &priv->children[priv->slots[next] - 1];
+        home = child_hash(child->notify, child->child, child->data) & priv->slot_mask;
+
+        /* can stay put if its home is cyclically in (slot, next] */
+        if (slot <= next ?
+            (slot < home && home <= next) :
+            (slot < home || home <= next))
+            continue;
+
+        priv->slots[slot] = priv->slots[next];
+        slot = next;
+    }
+
+    priv->slots[slot] = 0;
+}
+
+static KeepAlive*
+keep_alive_priv_new(void)
+{
+    KeepAlive *priv;
+
+    priv = g_slice_new0(KeepAlive);
+    priv->slots = g_new0(guint, KEEP_ALIVE_MIN_SLOTS);
+    priv->slot_mask = KEEP_ALIVE_MIN_SLOTS - 1;
+
+    keep_alive_stats.keep_alives += 1;
+
+    return priv;
+}
+
+static void
+keep_alive_priv_free(KeepAlive *priv)
+{
+    keep_alive_stats.keep_alives -= 1;
+
+    if (priv->shard != NULL) {
+        keep_alive_stats.shards = g_slist_remove(keep_alive_stats.shards, priv);
+        g_free(priv->shard);
+    }
+
+    g_free(priv->children);
+    g_free(priv->slots);
+    g_slice_free(KeepAlive, priv);
 }
 
 /* If we set JSCLASS_CONSTRUCT_PROTOTYPE flag, then this is called on
@@ -97,8 +270,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(keep_alive)
 
     GJS_NATIVE_CONSTRUCTOR_PRELUDE(keep_alive);
 
-    priv = g_slice_new0(KeepAlive);
-    priv->children = g_hash_table_new_full(child_hash, child_equal, NULL, child_free);
+    priv = keep_alive_priv_new();
 
     g_assert(priv_from_js(context, object) == NULL);
     JS_SetPrivate(context, object, priv);
@@ -116,8 +288,6 @@ keep_alive_finalize(JSContext *context,
                     JSObject  *obj)
 {
     KeepAlive *priv;
-    void *key;
-    void *value;
 
     priv = priv_from_js(context, obj);
 
@@ -129,31 +299,22 @@ keep_alive_finalize(JSContext *context,
 
     priv->inside_finalize = TRUE;
 
-    while (gjs_g_hash_table_steal_one(priv->children,
-                                      &key, &value)) {
-        Child *child = value;
-        if (child->notify)
-            (* child->notify) (child->child, child->data);
+    /* adding and removing children is refused while inside_finalize,
+     * so the notifiers can't change the array under us
+     */
+    while (priv->n_children > 0) {
+        Child *child;
 
-        child_free(child);
-    }
+        priv->n_children -= 1;
+        child = &priv->children[priv->n_children];
 
-    g_hash_table_destroy(priv->children);
-    g_slice_free(KeepAlive, priv);
-}
+        keep_alive_stats.children -= 1;
 
-static void
-trace_foreach(void *key,
-              void *value,
-              void *data)
-{
-    Child *child = value;
-    JSTracer *tracer = data;
-
-    if (child->child != NULL) {
-        JS_SET_TRACING_DETAILS(tracer, NULL, "keep-alive", 0);
-        JS_CallTracer(tracer, child->child, JSTRACE_OBJECT);
+        if (child->notify)
+            (* child->notify) (child->child, child->data);
     }
+
+    keep_alive_priv_free(priv);
 }
 
 static void
@@ -161,6 +322,9 @@ keep_alive_trace(JSTracer *tracer,
                  JSObject *obj)
 {
     KeepAlive *priv;
+    Child *child;
+    Child *end;
+    gint64 start;
 
     priv = priv_from_js(tracer->context, obj);
 
@@ -169,7 +333,24 @@ keep_alive_trace(JSTracer *tracer,
 
     g_assert(!priv->inside_trace);
     priv->inside_trace = TRUE;
-    g_hash_table_foreach(priv->children, trace_foreach, tracer);
+
+    start = 0;
+    if (keep_alive_stats.enabled)
+        start = JS_Now();
+
+    end = priv->children + priv->n_children;
+    for (child = priv->children; child != end; child++) {
+        if (child->child != NULL) {
+            JS_SET_TRACING_DETAILS(tracer, NULL, "keep-alive", 0);
+            JS_CallTracer(tracer, child->child, JSTRACE_OBJECT);
+        }
+    }
+
+    if (keep_alive_stats.enabled) {
+        priv->n_traces += 1;
+        priv->trace_time += JS_Now() - start;
+    }
+
     priv->inside_trace = FALSE;
 }
 
@@ -226,6 +407,8 @@ gjs_keep_alive_new(JSContext *context)
 
     g_assert(context != NULL);
 
+    init_keep_alive_stats();
+
     JS_BeginRequest(context);
 
     global = gjs_get_import_global(context);
@@ -294,6 +477,7 @@ gjs_keep_alive_add_child(JSContext         *context,
 {
     KeepAlive *priv;
     Child *child;
+    guint slot;
 
     g_assert(keep_alive != NULL);
 
@@ -306,18 +490,32 @@ gjs_keep_alive_add_child(JSContext         *context,
     g_return_if_fail(!priv->inside_trace);
     g_return_if_fail(!priv->inside_finalize);
 
-    child = g_slice_new0(Child);
+    slot = find_slot(priv, notify, obj, data);
+
+    /* there should not be an identical-by-value previous child */
+    g_return_if_fail(priv->slots[slot] == 0);
+
+    if (priv->n_children == priv->n_allocated) {
+        priv->n_allocated = MAX(priv->n_allocated * 2, KEEP_ALIVE_MIN_SLOTS / 2);
+        priv->children = g_renew(Child, priv->children, priv->n_allocated);
+    }
+
+    child = &priv->children[priv->n_children];
     child->notify = notify;
     child->child = obj;
     child->data = data;
 
-    /* this is sort of an expensive check, probably */
-    g_return_if_fail(g_hash_table_lookup(priv->children, child) == NULL);
+    priv->n_children += 1;
+    priv->slots[slot] = priv->n_children;
 
-    /* this overwrites any identical-by-value previous child,
-     * but there should not be one.
-     */
-    g_hash_table_replace(priv->children, child, child);
+    /* keep the table at most half full */
+    if (priv->n_children * 2 > priv->slot_mask + 1)
+        resize_slots(priv, (priv->slot_mask + 1) * 2);
+
+    keep_alive_stats.children += 1;
+    keep_alive_stats.peak_children = MAX(keep_alive_stats.peak_children,
+                                         keep_alive_stats.children);
+    keep_alive_stats.added += 1;
 }
 
 void
@@ -328,7 +526,9 @@ gjs_keep_alive_remove_child(JSContext         *context,
                             void              *data)
 {
     KeepAlive *priv;
-    Child child;
+    guint slot;
+    guint index;
+    guint last;
 
     JS_BeginRequest(context);
     priv = priv_from_js(context, keep_alive);
@@ -339,23 +539,68 @@ gjs_keep_alive_remove_child(JSContext         *context,
     g_return_if_fail(!priv->inside_trace);
     g_return_if_fail(!priv->inside_finalize);
 
-    child.notify = notify;
-    child.child = obj;
-    child.data = data;
+    slot = find_slot(priv, notify, obj, data);
+    if (priv->slots[slot] == 0)
+        return;
+
+    index = priv->slots[slot] - 1;
+    remove_slot(priv, slot);
+
+    /* fill the hole with the last child, and point its slot at the new position */
+    last = priv->n_children - 1;
+    if (index != last) {
+        Child *moved = &priv->children[last];
 
-    g_hash_table_remove(priv->children,
-                        &child);
+        slot = find_slot(priv, moved->notify, moved->child, moved->data);
+        g_assert(priv->slots[slot] == last + 1);
+
+        priv->children[index] = *moved;
+        priv->slots[slot] = index + 1;
+    }
+
+    priv->n_children -= 1;
+
+    /* give memory back when a large keep-alive empties out */
+    if (priv->slot_mask + 1 > KEEP_ALIVE_MIN_SLOTS &&
+        priv->n_children * 8 < priv->slot_mask + 1)
+        resize_slots(priv, (priv->slot_mask + 1) / 2);
+
+    keep_alive_stats.children -= 1;
+    keep_alive_stats.removed += 1;
+}
+
+/**
+ * gjs_keep_alive_get_n_children:
+ * @context: a #JSContext
+ * @keep_alive: a keep-alive object
+ *
+ * Return value: the number of children @keep_alive currently holds
+ */
+guint
+gjs_keep_alive_get_n_children(JSContext *context,
+                              JSObject  *keep_alive)
+{
+    KeepAlive *priv;
+
+    JS_BeginRequest(context);
+    priv = priv_from_js(context, keep_alive);
+    JS_EndRequest(context);
+
+    g_assert(priv != NULL);
+
+    return priv->n_children;
 }
 
 #define GLOBAL_KEEP_ALIVE_NAME "__gc_this_on_context_destroy"
 
 static JSObject*
-gjs_keep_alive_get_from_parent(JSContext *context,
-                               JSObject  *parent)
+gjs_keep_alive_get_from_parent(JSContext  *context,
+                               JSObject   *parent,
+                               const char *name)
 {
     jsval value;
 
-    gjs_object_get_property(context, parent, GLOBAL_KEEP_ALIVE_NAME, &value);
+    gjs_object_get_property(context, parent, name, &value);
 
     if (JSVAL_IS_OBJECT(value))
         return JSVAL_TO_OBJECT(value);
@@ -367,12 +612,14 @@ JSObject*
 gjs_keep_alive_get_global(JSContext *context)
 {
     return gjs_keep_alive_get_from_parent(context,
-                                          JS_GetGlobalObject(context));
+                                          JS_GetGlobalObject(context),
+                                          GLOBAL_KEEP_ALIVE_NAME);
 }
 
 static JSObject*
-gjs_keep_alive_create_in_parent(JSContext *context,
-                                JSObject  *parent)
+gjs_keep_alive_create_in_parent(JSContext  *context,
+                                JSObject   *parent,
+                                const char *name)
 {
     JSObject *keep_alive;
 
@@ -381,7 +628,7 @@ gjs_keep_alive_create_in_parent(JSContext *context,
     keep_alive = gjs_keep_alive_new(context);
 
     if (!JS_DefineProperty(context, parent,
-                           GLOBAL_KEEP_ALIVE_NAME,
+                           name,
                            OBJECT_TO_JSVAL(keep_alive),
                            NULL, NULL,
                            /* No ENUMERATE since this is a hidden
@@ -398,7 +645,8 @@ static JSObject*
 gjs_keep_alive_create_in_global(JSContext *context)
 {
     return gjs_keep_alive_create_in_parent(context,
-                                           JS_GetGlobalObject(context));
+                                           JS_GetGlobalObject(context),
+                                           GLOBAL_KEEP_ALIVE_NAME);
 }
 
 void
@@ -451,25 +699,221 @@ gjs_keep_alive_remove_global_child(JSContext         *context,
 
 JSObject*
 gjs_keep_alive_get_for_import_global(JSContext *context)
+{
+    return gjs_keep_alive_get_for_import_global_shard(context, NULL);
+}
+
+/**
+ * gjs_keep_alive_get_for_import_global_shard:
+ * @context: a #JSContext
+ * @shard: name of the shard, or %NULL for the default one
+ *
+ * Like gjs_keep_alive_get_for_import_global(), but returns one of
+ * several keep-alives on the import global, created on first use.
+ * Splitting children among shards, by namespace for example, keeps
+ * each keep-alive's table smaller and lets GJS_DEBUG_GI_STATS report
+ * how many children and how much tracing time each shard accounts for.
+ * They are all still marked on every GC.
+ *
+ * Return value: the keep-alive for @shard
+ */
+JSObject*
+gjs_keep_alive_get_for_import_global_shard(JSContext  *context,
+                                           const char *shard)
 {
     JSObject *global;
     JSObject *keep_alive;
+    char *name;
 
     global = gjs_get_import_global(context);
 
     g_assert(global != NULL);
 
+    if (shard != NULL)
+        name = g_strconcat(GLOBAL_KEEP_ALIVE_NAME, ":", shard, NULL);
+    else
+        name = g_strdup(GLOBAL_KEEP_ALIVE_NAME);
+
     JS_BeginRequest(context);
 
-    keep_alive = gjs_keep_alive_get_from_parent(context, global);
+    keep_alive = gjs_keep_alive_get_from_parent(context, global, name);
 
-    if (!keep_alive)
-        keep_alive = gjs_keep_alive_create_in_parent(context, global);
+    if (!keep_alive) {
+        KeepAlive *priv;
 
-    if (!keep_alive)
-        gjs_fatal("could not create keep_alive on global object, no memory?");
+        keep_alive = gjs_keep_alive_create_in_parent(context, global, name);
+
+        if (!keep_alive)
+            gjs_fatal("could not create keep_alive on global object, no memory?");
+
+        priv = priv_from_js(context, keep_alive);
+        priv->shard = g_strdup(shard != NULL ? shard : "default");
+        keep_alive_stats.shards = g_slist_prepend(keep_alive_stats.shards, priv);
+    }
 
     JS_EndRequest(context);
 
+    g_free(name);
+
     return keep_alive;
 }
+
+#if GJS_BUILD_TESTS
+
+#define N_TEST_CHILDREN 2000
+
+static guint test_notify_a_count = 0;
+static guint test_notify_b_count = 0;
+
+static void
+test_notify_a(JSObject *obj,
+              void     *data)
+{
+    test_notify_a_count += 1;
+}
+
+static void
+test_notify_b(JSObject *obj,
+              void     *data)
+{
+    test_notify_b_count += 1;
+}
+
+/* Child number @i; the even and odd ones come in pairs with identical
+ * hashes, so every lookup also has to step past a collision.
+ */
+static void
+test_child(guint            i,
+           GjsUnrootedFunc *notify_p,
+           void           **data_p)
+{
+    guint n = i / 2 + 1;
+
+    if (i % 2 == 0) {
+        *notify_p = test_notify_a;
+        *data_p = GUINT_TO_POINTER(n);
+    } else {
+        *notify_p = test_notify_b;
+        *data_p = GUINT_TO_POINTER(n ^
+                                   GPOINTER_TO_UINT(test_notify_a) ^
+                                   GPOINTER_TO_UINT(test_notify_b));
+    }
+}
+
+static void
+test_check_children(KeepAlive *priv,
+                    gboolean  *present,
+                    guint      n_present)
+{
+    guint i;
+
+    g_assert_cmpuint(priv->n_children, ==, n_present);
+
+    for (i = 0; i < N_TEST_CHILDREN; i++) {
+        GjsUnrootedFunc notify;
+        void *data;
+        guint slot;
+
+        test_child(i, &notify, &data);
+        slot = find_slot(priv, notify, NULL, data);
+
+        if (present[i]) {
+            g_assert_cmpuint(priv->slots[slot], !=, 0);
+            g_assert(child_equal(&priv->children[priv->slots[slot] - 1],
+                                 notify, NULL, data));
+        } else {
+            g_assert_cmpuint(priv->slots[slot], ==, 0);
+        }
+    }
+}
+
+void
+gjstest_test_func_gjs_keep_alive_add_remove(void)
+{
+    GjsContext *gjs_context;
+    JSContext *context;
+    JSObject *keep_alive;
+    KeepAlive *priv;
+    gboolean present[N_TEST_CHILDREN] = { FALSE, };
+    guint order[N_TEST_CHILDREN];
+    guint n_present;
+    GRand *rand;
+    guint i;
+
+    gjs_context = gjs_context_new();
+    context = gjs_context_get_native_context(gjs_context);
+    JS_BeginRequest(context);
+
+    keep_alive = gjs_keep_alive_get_for_import_global_shard(context, "test");
+    priv = priv_from_js(context, keep_alive);
+    g_assert(priv != NULL);
+
+    n_present = 0;
+    for (i = 0; i < N_TEST_CHILDREN; i++) {
+        GjsUnrootedFunc notify;
+        void *data;
+
+        test_child(i, &notify, &data);
+        gjs_keep_alive_add_child(context, keep_alive, notify, NULL, data);
+        present[i] = TRUE;
+        n_present += 1;
+
+        g_assert_cmpuint(gjs_keep_alive_get_n_children(context, keep_alive), ==, n_present);
+    }
+    test_check_children(priv, present, n_present);
+
+    /* Remove in a shuffled order, so that holes open up in the middle
+     * of probe sequences, including ones that wrap around the end of
+     * the table, and the table shrinks along the way. Removing a
+     * child twice must be harmless.
+     */
+    rand = g_rand_new_with_seed(42);
+    for (i = 0; i < N_TEST_CHILDREN; i++)
+        order[i] = i;
+    for (i = N_TEST_CHILDREN - 1; i > 0; i--) {
+        guint j = g_rand_int_range(rand, 0, i + 1);
+        guint tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    for (i = 0; i < N_TEST_CHILDREN; i++) {
+        GjsUnrootedFunc notify;
+        void *data;
+
+        test_child(order[i], &notify, &data);
+        gjs_keep_alive_remove_child(context, keep_alive, notify, NULL, data);
+        present[order[i]] = FALSE;
+        n_present -= 1;
+
+        gjs_keep_alive_remove_child(context, keep_alive, notify, NULL, data);
+
+        g_assert_cmpuint(gjs_keep_alive_get_n_children(context, keep_alive), ==, n_present);
+        if (i % 97 == 0 || n_present < 32)
+            test_check_children(priv, present, n_present);
+
+        /* Put some back in between */
+        if (i % 5 == 0) {
+            guint back = order[i / 2];
+
+            if (!present[back]) {
+                test_child(back, &notify, &data);
+                gjs_keep_alive_add_child(context, keep_alive, notify, NULL, data);
+                present[back] = TRUE;
+                n_present += 1;
+            }
+        }
+    }
+    test_check_children(priv, present, n_present);
+    g_assert_cmpuint(priv->slot_mask + 1, <, N_TEST_CHILDREN);
+
+    g_rand_free(rand);
+
+    /* Whatever is left is notified when the context goes away */
+    JS_EndRequest(context);
+    test_notify_a_count = test_notify_b_count = 0;
+    g_object_unref(gjs_context);
+    g_assert_cmpuint(test_notify_a_count + test_notify_b_count, ==, n_present);
+}
+
+#endif /* GJS_BUILD_TESTS */
@@ -64,6 +64,8 @@ void      gjs_keep_alive_remove_child              (JSContext         *context,
                                                     GjsUnrootedFunc  notify,
                                                     JSObject          *child,
                                                     void              *data);
+guint     gjs_keep_alive_get_n_children            (JSContext         *context,
+                                                    JSObject          *keep_alive);
 JSObject* gjs_keep_alive_get_global                (JSContext         *context);
 void      gjs_keep_alive_add_global_child          (JSContext         *context,
                                                     GjsUnrootedFunc  notify,
@@ -74,6 +76,8 @@ void      gjs_keep_alive_remove_global_child       (JSContext         *context,
                                                     JSObject          *child,
                                                     void              *data);
 JSObject* gjs_keep_alive_get_for_import_global    (JSContext         *context);
+JSObject* gjs_keep_alive_get_for_import_global_shard (JSContext         *context,
+                                                      const char        *shard);
 
 G_END_DECLS
 
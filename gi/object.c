@@ -35,6 +35,7 @@
 
 #include <gjs/gjs-module.h>
 #include <gjs/compat.h>
+#include <gjs/profiler.h>
 
 #include <util/log.h>
 
@@ -42,17 +43,104 @@
 
 #include <girepository.h>
 
+/* Per-class data, created for the prototype and shared with all its
+ * instances so that those only need the few fields below. It is
+ * refcounted because a prototype and its instances can be finalized
+ * in the same GC in any order.
+ */
 typedef struct {
     GIObjectInfo *info;
+    GType gtype;
+    guint ref_count;
+    /* whether define_all_methods() has been considered */
+    guint eager_define_checked : 1;
+    /* see find_param_spec() */
+    GHashTable *param_specs;
+    /* see get_keep_alive_shard(); reachable from the import global */
+    JSObject *keep_alive_shard;
+} ObjectPrototype;
+
+typedef struct {
+    ObjectPrototype *proto_data; /* NULL until the prototype is set up */
     GObject *gobj; /* NULL if we are the prototype and not an instance */
     JSObject *keep_alive; /* NULL if we are not added to it */
-    GType gtype;
+    /* see wrapped_gobj_toggle_notify() */
+    guint toggle_queued : 1;
+    guint toggle_down_pending : 1;
 } ObjectInstance;
 
-static ObjectInstance unthreadsafe_template_for_constructor = { NULL, NULL };
-
 static struct JSClass gjs_object_instance_class;
 
+/* Dumped with the profiler data if GJS_DEBUG_GI_STATS is set */
+static struct {
+    guint wrappers;
+    guint prototypes;
+    /* toggle refs, see ToggleQueue */
+    guint toggle_notifications;
+    guint toggle_coalesced;
+    guint toggle_applied;
+} object_stats;
+
+static void
+dump_object_stats(FILE *fp,
+                  void *data)
+{
+    /* Each wrapper also costs a JSObject, a keep-alive entry while
+     * the GObject has other refs, and a qdata entry and toggle ref on
+     * the GObject; only our own allocation is counted here.
+     */
+    fprintf(fp, "object wrappers: %u live, %u bytes each; %u prototypes, %u bytes each\n",
+            object_stats.wrappers,
+            (guint) sizeof(ObjectInstance),
+            object_stats.prototypes,
+            (guint) (sizeof(ObjectInstance) + sizeof(ObjectPrototype)));
+
+    fprintf(fp, "toggle refs: %u notifications, %u coalesced, %u applied\n",
+            object_stats.toggle_notifications,
+            object_stats.toggle_coalesced,
+            object_stats.toggle_applied);
+
+    /* reset counters so that next dump is delta from previous */
+    object_stats.toggle_notifications = 0;
+    object_stats.toggle_coalesced = 0;
+    object_stats.toggle_applied = 0;
+}
+
+static void
+init_object_stats(void)
+{
+    static gboolean initialized = FALSE;
+
+    if (G_LIKELY(initialized))
+        return;
+    initialized = TRUE;
+
+    if (g_getenv("GJS_DEBUG_GI_STATS") != NULL)
+        gjs_profiler_add_dump_func(dump_object_stats, NULL);
+}
+
+static ObjectPrototype*
+object_prototype_ref(ObjectPrototype *proto_data)
+{
+    proto_data->ref_count += 1;
+    return proto_data;
+}
+
+static void
+object_prototype_unref(ObjectPrototype *proto_data)
+{
+    proto_data->ref_count -= 1;
+    if (proto_data->ref_count > 0)
+        return;
+
+    g_base_info_unref( (GIBaseInfo*) proto_data->info);
+    if (proto_data->param_specs)
+        g_hash_table_destroy(proto_data->param_specs);
+
+    object_stats.prototypes -= 1;
+    g_slice_free(ObjectPrototype, proto_data);
+}
+
 GJS_DEFINE_DYNAMIC_PRIV_FROM_JS(ObjectInstance, gjs_object_instance_class)
 
 static JSObject*       peek_js_obj  (JSContext *context,
@@ -60,6 +148,12 @@ static JSObject*       peek_js_obj  (JSContext *context,
 static void            set_js_obj   (JSContext *context,
                                      GObject   *gobj,
                                      JSObject  *obj);
+static void            associate_js_gobject (JSContext      *context,
+                                             JSObject       *object,
+                                             ObjectInstance *priv);
+static void            forget_prototype (JSContext *context,
+                                         JSObject  *proto,
+                                         GType      gtype);
 
 typedef enum {
     SOME_ERROR_OCCURRED = JS_FALSE,
@@ -67,6 +161,12 @@ typedef enum {
     VALUE_WAS_SET
 } ValueFromPropertyResult;
 
+static ValueFromPropertyResult init_g_param_from_param_spec(JSContext  *context,
+                                                            const char *js_prop_name,
+                                                            jsval       js_value,
+                                                            GParamSpec *param_spec,
+                                                            GParameter *parameter);
+
 static ValueFromPropertyResult
 init_g_param_from_property(JSContext  *context,
                            const char *js_prop_name,
@@ -93,6 +193,21 @@ init_g_param_from_property(JSContext  *context,
         return NO_SUCH_G_PROPERTY;
     }
 
+    return init_g_param_from_param_spec(context, js_prop_name, js_value,
+                                        param_spec, parameter);
+}
+
+/* @js_prop_name is only used for messages, and may be NULL */
+static ValueFromPropertyResult
+init_g_param_from_param_spec(JSContext  *context,
+                             const char *js_prop_name,
+                             jsval       js_value,
+                             GParamSpec *param_spec,
+                             GParameter *parameter)
+{
+    if (js_prop_name == NULL)
+        js_prop_name = param_spec->name;
+
     if ((param_spec->flags & G_PARAM_WRITABLE) == 0) {
         /* prevent setting the prop even in JS */
         gjs_throw(context, "Property %s (GObject %s) is not writable",
@@ -115,6 +230,74 @@ init_g_param_from_property(JSContext  *context,
     return VALUE_WAS_SET;
 }
 
+/* Finds the GParamSpec for a JS property name on @gobj, or NULL if it
+ * isn't a GObject property. Properties that are found are cached on
+ * the prototype keyed by jsid, so repeated gets and sets of the same
+ * property skip the string conversion, hyphenation and class lookup.
+ * Misses (JS-only properties like this._foo) are not cached, so the
+ * table is bounded by the class's properties. The name of each cached
+ * id is pinned with JS_InternString() so that the atom, and thus the
+ * key, can't be collected and reused for a different name.
+ * Returns FALSE if the id isn't a string.
+ */
+static JSBool
+find_param_spec(JSContext   *context,
+                JSObject    *obj,
+                GObject     *gobj,
+                jsid         id,
+                char       **name_p,
+                GParamSpec **param_p)
+{
+    ObjectInstance *proto_priv;
+    GParamSpec *param;
+    char *name;
+    char *gname;
+
+    *name_p = NULL;
+
+    /* The cache only applies when the prototype is the one for the
+     * object's exact type; subclasses we don't know about may have
+     * extra properties.
+     */
+    proto_priv = priv_from_js(context, JS_GetPrototype(context, obj));
+    if (proto_priv != NULL && proto_priv->gobj == NULL &&
+        proto_priv->proto_data != NULL &&
+        proto_priv->proto_data->gtype == G_OBJECT_TYPE(gobj)) {
+        if (proto_priv->proto_data->param_specs != NULL) {
+            param = g_hash_table_lookup(proto_priv->proto_data->param_specs,
+                                        (gpointer) JSID_BITS(id));
+            if (param != NULL) {
+                *param_p = param;
+                return JS_TRUE;
+            }
+        }
+    } else {
+        proto_priv = NULL;
+    }
+
+    if (!gjs_get_string_id(context, id, &name))
+        return JS_FALSE;
+
+    gname = gjs_hyphen_from_camel(name);
+    param = g_object_class_find_property(G_OBJECT_GET_CLASS(gobj),
+                                         gname);
+    g_free(gname);
+
+    if (proto_priv != NULL && param != NULL &&
+        JS_InternString(context, name) != NULL) {
+        if (proto_priv->proto_data->param_specs == NULL)
+            proto_priv->proto_data->param_specs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                            NULL, (GDestroyNotify) g_param_spec_unref);
+        g_hash_table_insert(proto_priv->proto_data->param_specs,
+                            (gpointer) JSID_BITS(id),
+                            g_param_spec_ref(param));
+    }
+
+    *name_p = name;
+    *param_p = param;
+    return JS_TRUE;
+}
+
 /* a hook on getting a property; set value_p to override property's value.
  * Return value is JS_FALSE on OOM/exception.
  */
@@ -125,30 +308,25 @@ object_instance_get_prop(JSContext *context,
                          jsval     *value_p)
 {
     ObjectInstance *priv;
-    char *name;
-    char *gname;
+    char *name = NULL;
     GParamSpec *param;
     GValue gvalue = { 0, };
     JSBool ret = JS_TRUE;
 
-    if (!gjs_get_string_id(context, id, &name))
+    if (!JSID_IS_STRING(id))
         return JS_TRUE; /* not resolved, but no error */
 
     priv = priv_from_js(context, obj);
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Get prop '%s' hook obj %p priv %p", name, obj, priv);
+                     "Get prop hook obj %p priv %p", obj, priv);
 
-    if (priv == NULL) {
-        ret = JS_FALSE; /* wrong class passed in */
-        goto out;
-    }
+    if (priv == NULL)
+        return JS_FALSE; /* wrong class passed in */
     if (priv->gobj == NULL) /* prototype, not an instance. */
-        goto out;
+        return JS_TRUE;
 
-    gname = gjs_hyphen_from_camel(name);
-    param = g_object_class_find_property(G_OBJECT_GET_CLASS(priv->gobj),
-                                         gname);
-    g_free(gname);
+    if (!find_param_spec(context, obj, priv->gobj, id, &name, &param))
+        goto out;
 
     if (param == NULL) {
         /* leave value_p as it was */
@@ -159,8 +337,8 @@ object_instance_get_prop(JSContext *context,
         goto out;
 
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Overriding %s with GObject prop %s",
-                     name, param->name);
+                     "Overriding with GObject prop %s",
+                     param->name);
 
     g_value_init(&gvalue, G_PARAM_SPEC_VALUE_TYPE(param));
     g_object_get_property(priv->gobj, param->name,
@@ -190,28 +368,31 @@ object_instance_set_prop(JSContext *context,
                          jsval     *value_p)
 {
     ObjectInstance *priv;
-    char *name;
+    char *name = NULL;
+    GParamSpec *param_spec;
     GParameter param = { NULL, { 0, }};
     JSBool ret = JS_TRUE;
 
-    if (!gjs_get_string_id(context, id, &name))
+    if (!JSID_IS_STRING(id))
         return JS_TRUE; /* not resolved, but no error */
 
     priv = priv_from_js(context, obj);
     gjs_debug_jsprop(GJS_DEBUG_GOBJECT,
-                     "Set prop '%s' hook obj %p priv %p", name, obj, priv);
+                     "Set prop hook obj %p priv %p", obj, priv);
 
-    if (priv == NULL) {
-        ret = JS_FALSE;  /* wrong class passed in */
-        goto out;
-    }
+    if (priv == NULL)
+        return JS_FALSE;  /* wrong class passed in */
     if (priv->gobj == NULL) /* prototype, not an instance. */
-        goto out;
+        return JS_TRUE;
+
+    if (!find_param_spec(context, obj, priv->gobj, id, &name, &param_spec) ||
+        param_spec == NULL)
+        goto out; /* not a GObject prop, so nothing else to do */
 
-    switch (init_g_param_from_property(context, name,
-                                       *value_p,
-                                       G_TYPE_FROM_INSTANCE(priv->gobj),
-                                       &param)) {
+    switch (init_g_param_from_param_spec(context, name,
+                                         *value_p,
+                                         param_spec,
+                                         &param)) {
     case SOME_ERROR_OCCURRED:
         ret = JS_FALSE;
     case NO_SUCH_G_PROPERTY:
@@ -236,6 +417,163 @@ object_instance_set_prop(JSContext *context,
     return ret;
 }
 
+static GIFunctionInfo*
+find_method_uncached(ObjectInstance *priv,
+                     const char     *name)
+{
+    GIFunctionInfo *method_info;
+
+    method_info = g_object_info_find_method_using_interfaces(priv->proto_data->info,
+                                                             name,
+                                                             NULL);
+
+    /**
+     * Search through any interfaces implemented by the GType;
+     * this could be done better.  See
+     * https://bugzilla.gnome.org/show_bug.cgi?id=632922
+     */
+    if (method_info == NULL) {
+        GType *interfaces;
+        guint n_interfaces;
+        guint i;
+
+        interfaces = g_type_interfaces (priv->proto_data->gtype, &n_interfaces);
+        for (i = 0; i < n_interfaces; i++) {
+            GIBaseInfo *base_info;
+            GIInterfaceInfo *iface_info;
+
+            base_info = g_irepository_find_by_gtype(g_irepository_get_default(),
+                                                    interfaces[i]);
+            if (!base_info)
+                continue;
+
+            if (g_base_info_get_type(base_info) != GI_INFO_TYPE_INTERFACE) {
+                g_base_info_unref(base_info);
+                continue;
+            }
+
+            iface_info = (GIInterfaceInfo*) base_info;
+
+            method_info = g_interface_info_find_method(iface_info, name);
+
+            g_base_info_unref(base_info);
+
+            if (method_info != NULL) {
+                gjs_debug(GJS_DEBUG_GOBJECT,
+                          "Found method %s in native interface %s",
+                          name, g_type_name(interfaces[i]));
+                break;
+            }
+        }
+        g_free(interfaces);
+    }
+
+    return method_info;
+}
+
+/* Results of find_method_uncached(), hits and misses, per GType:
+ * GType => MethodCache. JS looks up lots of names which aren't
+ * methods (toString, constructor, expando fields) on prototypes,
+ * and each miss would otherwise walk all the type's interfaces in
+ * the typelib again. Typelibs are never unloaded, so the cached
+ * infos stay valid for the life of the process.
+ */
+typedef struct {
+    /* name => GIFunctionInfo, or METHOD_CACHE_MISS */
+    GHashTable *methods;
+    guint n_misses;
+} MethodCache;
+
+static GHashTable *method_caches = NULL;
+
+#define METHOD_CACHE_MISS ((gpointer) &method_caches)
+
+/* Misses are unbounded in principle (any name can be looked up), so
+ * stop recording them for a type past this many.
+ */
+#define METHOD_CACHE_MAX_MISSES 512
+
+static GIFunctionInfo*
+find_method(ObjectInstance *priv,
+            const char     *name)
+{
+    MethodCache *cache;
+    GIFunctionInfo *method_info;
+    gpointer cached;
+
+    /* Unknown until the prototype has been set up; don't cache */
+    if (priv->proto_data->gtype == G_TYPE_INVALID)
+        return find_method_uncached(priv, name);
+
+    if (G_UNLIKELY(method_caches == NULL))
+        method_caches = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    cache = g_hash_table_lookup(method_caches, (gpointer) priv->proto_data->gtype);
+    if (cache == NULL) {
+        cache = g_slice_new0(MethodCache);
+        cache->methods = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, NULL);
+        g_hash_table_insert(method_caches, (gpointer) priv->proto_data->gtype, cache);
+    }
+
+    cached = g_hash_table_lookup(cache->methods, name);
+    if (cached == METHOD_CACHE_MISS)
+        return NULL;
+    if (cached != NULL)
+        return (GIFunctionInfo*) g_base_info_ref((GIBaseInfo*) cached);
+
+    method_info = find_method_uncached(priv, name);
+
+    if (method_info != NULL) {
+        /* the cache keeps its own ref */
+        g_hash_table_insert(cache->methods, g_strdup(name),
+                            g_base_info_ref((GIBaseInfo*) method_info));
+    } else if (cache->n_misses < METHOD_CACHE_MAX_MISSES) {
+        g_hash_table_insert(cache->methods, g_strdup(name), METHOD_CACHE_MISS);
+        cache->n_misses += 1;
+    }
+
+    return method_info;
+}
+
+/* Defines all of the class's own non-deprecated methods on its prototype
+ * in one go, for namespaces where gjs_function_define_eagerly() says so.
+ */
+static JSBool
+define_all_methods(JSContext      *context,
+                   JSObject       *proto,
+                   ObjectInstance *priv)
+{
+    int i, n_methods;
+
+    n_methods = g_object_info_get_n_methods(priv->proto_data->info);
+
+    for (i = 0; i < n_methods; i++) {
+        GIFunctionInfo *meth_info;
+        GIFunctionInfoFlags flags;
+
+        meth_info = g_object_info_get_method(priv->proto_data->info, i);
+        flags = g_function_info_get_flags (meth_info);
+
+        if ((flags & GI_FUNCTION_IS_METHOD) &&
+            !g_base_info_is_deprecated((GIBaseInfo*) meth_info) &&
+            gjs_define_function(context, proto, meth_info) == NULL) {
+            g_base_info_unref((GIBaseInfo*) meth_info);
+            return JS_FALSE;
+        }
+
+        g_base_info_unref((GIBaseInfo*) meth_info);
+    }
+
+    gjs_debug(GJS_DEBUG_GOBJECT,
+              "Defined %d methods eagerly in prototype for %s.%s",
+              n_methods,
+              g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+              g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
+
+    return JS_TRUE;
+}
+
 /*
  * Like JSResolveOp, but flags provide contextual information as follows:
  *
@@ -272,8 +610,8 @@ object_instance_new_resolve(JSContext *context,
                      name,
                      obj,
                      priv,
-                     priv ? g_base_info_get_namespace (priv->info) : "",
-                     priv ? g_base_info_get_name (priv->info) : "",
+                     (priv && priv->proto_data) ? g_base_info_get_namespace (priv->proto_data->info) : "",
+                     (priv && priv->proto_data) ? g_base_info_get_name (priv->proto_data->info) : "",
                      priv ? priv->gobj : NULL,
                      (priv && priv->gobj) ? g_type_name_from_instance((GTypeInstance*) priv->gobj) : "(type unknown)");
 
@@ -284,6 +622,30 @@ object_instance_new_resolve(JSContext *context,
         /* We are the prototype, so look for methods and other class properties */
         GIFunctionInfo *method_info;
 
+        if (priv->proto_data == NULL) {
+            /* still in gjs_define_object_class() */
+            ret = JS_TRUE;
+            goto out;
+        }
+
+        if (!priv->proto_data->eager_define_checked) {
+            priv->proto_data->eager_define_checked = TRUE;
+
+            if (gjs_function_define_eagerly(g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info))) {
+                JSBool found;
+
+                if (!define_all_methods(context, obj, priv) ||
+                    !JS_AlreadyHasOwnProperty(context, obj, name, &found))
+                    goto out;
+
+                if (found) {
+                    *objp = obj;
+                    ret = JS_TRUE;
+                    goto out;
+                }
+            }
+        }
+
         /* find_method does not look at methods on parent classes,
          * we rely on javascript to walk up the __proto__ chain
          * and find those and define them in the right prototype.
@@ -294,51 +656,7 @@ object_instance_new_resolve(JSContext *context,
          * copies of the iface methods (one per object class node that
          * introduces the iface)
          */
-
-        method_info = g_object_info_find_method_using_interfaces(priv->info,
-                                                                 name,
-                                                                 NULL);
-
-        /**
-         * Search through any interfaces implemented by the GType;
-         * this could be done better.  See
-         * https://bugzilla.gnome.org/show_bug.cgi?id=632922
-         */
-        if (method_info == NULL) {
-            GType *interfaces;
-            guint n_interfaces;
-            guint i;
-
-            interfaces = g_type_interfaces (priv->gtype, &n_interfaces);
-            for (i = 0; i < n_interfaces; i++) {
-                GIBaseInfo *base_info;
-                GIInterfaceInfo *iface_info;
-
-                base_info = g_irepository_find_by_gtype(g_irepository_get_default(),
-                                                        interfaces[i]);
-                if (!base_info)
-                    continue;
-
-                if (g_base_info_get_type(base_info) != GI_INFO_TYPE_INTERFACE) {
-                    g_base_info_unref(base_info);
-                    continue;
-                }
-
-                iface_info = (GIInterfaceInfo*) base_info;
-
-                method_info = g_interface_info_find_method(iface_info, name);
-
-                g_base_info_unref(base_info);
-
-                if (method_info != NULL) {
-                    gjs_debug(GJS_DEBUG_GOBJECT,
-                              "Found method %s in native interface %s",
-                              name, g_type_name(interfaces[i]));
-                    break;
-                }
-            }
-            g_free(interfaces);
-        }
+        method_info = find_method(priv, name);
 
         if (method_info != NULL) {
             const char *method_name;
@@ -354,9 +672,9 @@ object_instance_new_resolve(JSContext *context,
                 gjs_debug(GJS_DEBUG_GOBJECT,
                           "Ignoring definition of deprecated method %s in prototype for %s (%s.%s)",
                           method_name,
-                          g_type_name(priv->gtype),
-                          g_base_info_get_namespace( (GIBaseInfo*) priv->info),
-                          g_base_info_get_name( (GIBaseInfo*) priv->info));
+                          g_type_name(priv->proto_data->gtype),
+                          g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+                          g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
                 g_base_info_unref( (GIBaseInfo*) method_info);
                 ret = JS_TRUE;
                 goto out;
@@ -365,9 +683,9 @@ object_instance_new_resolve(JSContext *context,
             gjs_debug(GJS_DEBUG_GOBJECT,
                       "Defining method %s in prototype for %s (%s.%s)",
                       method_name,
-                      g_type_name(priv->gtype),
-                      g_base_info_get_namespace( (GIBaseInfo*) priv->info),
-                      g_base_info_get_name( (GIBaseInfo*) priv->info));
+                      g_type_name(priv->proto_data->gtype),
+                      g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+                      g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
 
             if (gjs_define_function(context, obj, method_info) == NULL) {
                 g_base_info_unref( (GIBaseInfo*) method_info);
@@ -391,19 +709,19 @@ object_instance_new_resolve(JSContext *context,
 
         proto = JS_GetPrototype(context, obj);
         proto_priv = priv_from_js(context, proto);
-        if (proto_priv->gtype == G_TYPE_INVALID) {
+        if (proto_priv->proto_data->gtype == G_TYPE_INVALID) {
             gjs_debug(GJS_DEBUG_GOBJECT,
                       "storing gtype %s (%d) to prototype %p",
                       G_OBJECT_TYPE_NAME(priv->gobj),
                       (int) G_OBJECT_TYPE(priv->gobj),
                       proto);
-            proto_priv->gtype = G_OBJECT_TYPE(priv->gobj);
-        } else if (proto_priv->gtype != G_OBJECT_TYPE(priv->gobj)) {
+            proto_priv->proto_data->gtype = G_OBJECT_TYPE(priv->gobj);
+        } else if (proto_priv->proto_data->gtype != G_OBJECT_TYPE(priv->gobj)) {
             gjs_fatal("conflicting gtypes for prototype %s (%d) (was %s (%d))",
                       G_OBJECT_TYPE_NAME(priv->gobj),
                       (int) G_OBJECT_TYPE(priv->gobj),
-                      g_type_name(proto_priv->gtype),
-                      (int) proto_priv->gtype);
+                      g_type_name(proto_priv->proto_data->gtype),
+                      (int) proto_priv->proto_data->gtype);
         }
     }
 
@@ -538,6 +856,27 @@ wrapped_gobj_dispose_notify(gpointer      data,
 }
 #endif
 
+/* Wrappers are kept alive in one keep-alive per namespace, so the
+ * GC cost of each library's wrappers shows up separately in the
+ * keep-alive stats. The shard is looked up once per class; it is a
+ * property of the import global, so it lives as long as the class.
+ */
+static JSObject*
+get_keep_alive_shard(JSContext      *context,
+                     ObjectInstance *priv)
+{
+    ObjectPrototype *proto_data = priv->proto_data;
+
+    if (G_UNLIKELY(proto_data->keep_alive_shard == NULL)) {
+        const char *ns;
+
+        ns = g_base_info_get_namespace( (GIBaseInfo*) proto_data->info);
+        proto_data->keep_alive_shard = gjs_keep_alive_get_for_import_global_shard(context, ns);
+    }
+
+    return proto_data->keep_alive_shard;
+}
+
 static void
 gobj_no_longer_kept_alive_func(JSObject *obj,
                                void     *data)
@@ -553,6 +892,162 @@ gobj_no_longer_kept_alive_func(JSObject *obj,
     priv->keep_alive = NULL;
 }
 
+/* Toggles down (the wrapper holds the last ref) are not applied right
+ * away but queued per runtime, and the wrappers removed from the keep
+ * alive from an idle, or at the start of a GC so that scripts which
+ * never run the main loop don't keep them alive across collections.
+ * An object that goes back above one ref before then, as happens all
+ * the time when widgets are added to and removed from containers,
+ * just has its pending toggle cancelled, so it never touches the keep
+ * alive at all. Toggles up are still applied immediately (or cancel a
+ * pending toggle down): delaying them could let the GC collect a
+ * wrapper that something else still needs.
+ */
+typedef struct {
+    JSRuntime *runtime;
+    GPtrArray *pending; /* ObjectInstance* with toggle_queued set */
+    guint idle_id;
+    JSGCCallback prev_gc_callback;
+} ToggleQueue;
+
+GJS_DEFINE_QUARK(gjs-gi-object-toggle-queue, toggle_queue)
+
+/* Apply the queue synchronously past this many entries, so that
+ * scripts which never return to the main loop can't grow it forever.
+ */
+#define TOGGLE_QUEUE_MAX_PENDING 1024
+
+static void
+toggle_queue_process(ToggleQueue *queue)
+{
+    JSContext *context;
+    GPtrArray *pending;
+    guint i;
+
+    if (queue->pending->len == 0)
+        return;
+
+    /* Swap in a new array first; removing from the keep alive can
+     * run arbitrary notifiers.
+     */
+    pending = queue->pending;
+    queue->pending = g_ptr_array_new();
+
+    context = gjs_runtime_get_current_context(queue->runtime);
+
+    for (i = 0; i < pending->len; i++) {
+        ObjectInstance *priv = g_ptr_array_index(pending, i);
+        JSObject *obj;
+
+        priv->toggle_queued = FALSE;
+        if (!priv->toggle_down_pending)
+            continue;
+        priv->toggle_down_pending = FALSE;
+
+        if (context == NULL || priv->keep_alive == NULL || priv->gobj == NULL)
+            continue;
+
+        obj = peek_js_obj(context, priv->gobj);
+        g_assert(obj != NULL);
+
+        gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "Removing object %p from keep alive", obj);
+        gjs_keep_alive_remove_child(context, priv->keep_alive,
+                                    gobj_no_longer_kept_alive_func,
+                                    obj,
+                                    priv);
+        priv->keep_alive = NULL;
+        object_stats.toggle_applied += 1;
+    }
+
+    g_ptr_array_free(pending, TRUE);
+}
+
+static gboolean
+toggle_queue_idle(gpointer data)
+{
+    ToggleQueue *queue = data;
+
+    queue->idle_id = 0;
+    toggle_queue_process(queue);
+
+    return FALSE;
+}
+
+static JSBool
+toggle_queue_gc_callback(JSContext *context,
+                         JSGCStatus status)
+{
+    JSRuntime *runtime;
+    ToggleQueue *queue;
+
+    runtime = JS_GetRuntime(context);
+    queue = gjs_runtime_get_data(runtime, toggle_queue_quark());
+
+    /* No current context means the runtime is being torn down, and
+     * everything is about to be collected anyway
+     */
+    if (status == JSGC_BEGIN &&
+        gjs_runtime_get_current_context(runtime) != NULL)
+        toggle_queue_process(queue);
+
+    if (queue->prev_gc_callback != NULL)
+        return (* queue->prev_gc_callback) (context, status);
+
+    return JS_TRUE;
+}
+
+static void
+toggle_queue_free(gpointer data)
+{
+    ToggleQueue *queue = data;
+    guint i;
+
+    if (queue->idle_id != 0)
+        g_source_remove(queue->idle_id);
+
+    for (i = 0; i < queue->pending->len; i++) {
+        ObjectInstance *priv = g_ptr_array_index(queue->pending, i);
+        priv->toggle_queued = FALSE;
+        priv->toggle_down_pending = FALSE;
+    }
+
+    g_ptr_array_free(queue->pending, TRUE);
+    g_slice_free(ToggleQueue, queue);
+}
+
+static ToggleQueue*
+get_toggle_queue(JSRuntime *runtime)
+{
+    ToggleQueue *queue;
+
+    queue = gjs_runtime_get_data(runtime, toggle_queue_quark());
+    if (G_LIKELY(queue != NULL))
+        return queue;
+
+    queue = g_slice_new0(ToggleQueue);
+    queue->runtime = runtime;
+    queue->pending = g_ptr_array_new();
+    gjs_runtime_set_data(runtime, toggle_queue_quark(), queue, toggle_queue_free);
+
+    queue->prev_gc_callback = JS_SetGCCallbackRT(runtime, toggle_queue_gc_callback);
+
+    return queue;
+}
+
+static void
+toggle_queue_remove(JSRuntime      *runtime,
+                    ObjectInstance *priv)
+{
+    ToggleQueue *queue;
+
+    priv->toggle_queued = FALSE;
+    priv->toggle_down_pending = FALSE;
+
+    queue = gjs_runtime_get_data(runtime, toggle_queue_quark());
+    if (queue != NULL)
+        g_ptr_array_remove_fast(queue->pending, priv);
+}
+
 static void
 wrapped_gobj_toggle_notify(gpointer      data,
                            GObject      *gobj,
@@ -585,29 +1080,52 @@ wrapped_gobj_toggle_notify(gpointer      data,
                         "Toggle notify gobj %p obj %p is_last_ref %d keep-alive %p",
                         gobj, obj, is_last_ref, priv->keep_alive);
 
+    object_stats.toggle_notifications += 1;
+
     if (is_last_ref) {
         /* Change to weak ref so the wrapper-wrappee pair can be
-         * collected by the GC
+         * collected by the GC; deferred, see ToggleQueue.
          */
-        if (priv->keep_alive != NULL) {
-            gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "Removing object from keep alive");
-            gjs_keep_alive_remove_child(context, priv->keep_alive,
-                                        gobj_no_longer_kept_alive_func,
-                                        obj,
-                                        priv);
-            priv->keep_alive = NULL;
+        if (priv->keep_alive != NULL && !priv->toggle_down_pending) {
+            ToggleQueue *queue;
+
+            queue = get_toggle_queue(runtime);
+
+            priv->toggle_down_pending = TRUE;
+            if (!priv->toggle_queued) {
+                priv->toggle_queued = TRUE;
+                g_ptr_array_add(queue->pending, priv);
+            }
+
+            if (queue->pending->len >= TOGGLE_QUEUE_MAX_PENDING) {
+                toggle_queue_process(queue);
+            } else if (queue->idle_id == 0) {
+                queue->idle_id = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+                                                 toggle_queue_idle,
+                                                 queue,
+                                                 NULL);
+            }
         }
+    } else if (priv->toggle_down_pending) {
+        /* The object is still in the keep alive, so just forget the
+         * pending toggle down. It stays in the queue array until the
+         * queue is processed, to save searching for it.
+         */
+        gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "Cancelling pending removal from keep alive");
+        priv->toggle_down_pending = FALSE;
+        object_stats.toggle_coalesced += 1;
     } else {
         /* Change to strong ref so the wrappee keeps the wrapper alive
          * in case the wrapper has data in it that the app cares about
          */
         if (priv->keep_alive == NULL) {
             gjs_debug_lifecycle(GJS_DEBUG_GOBJECT, "Adding object to keep alive");
-            priv->keep_alive = gjs_keep_alive_get_for_import_global(context);
+            priv->keep_alive = get_keep_alive_shard(context, priv);
             gjs_keep_alive_add_child(context, priv->keep_alive,
                                      gobj_no_longer_kept_alive_func,
                                      obj,
                                      priv);
+            object_stats.toggle_applied += 1;
         }
     }
 }
@@ -658,10 +1176,12 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(object_instance)
 
     if (!is_proto) {
         GType gtype;
+        GParameter *params;
+        int n_params;
 
-        /* If we're the prototype, then post-construct we'll fill in priv->info.
-         * If we are not the prototype, though, then we'll get ->info from the
-         * prototype and then create a GObject if we don't have one already.
+        /* If we're the prototype, then post-construct we'll fill in priv->proto_data.
+         * If we are not the prototype, though, then we'll share ->proto_data with the
+         * prototype and then create a GObject.
          */
         proto_priv = priv_from_js(context, proto);
         if (proto_priv == NULL) {
@@ -670,108 +1190,141 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(object_instance)
             return JS_FALSE;
         }
 
-        priv->info = proto_priv->info;
-        g_base_info_ref( (GIBaseInfo*) priv->info);
+        priv->proto_data = object_prototype_ref(proto_priv->proto_data);
 
-        /* Since gobject-introspection is always creating new info
-         * objects, == is not meaningful on them, only comparison of
-         * their names. We prefer to use the info that is already ref'd
-         * by the prototype for the class.
-         */
-        g_assert(unthreadsafe_template_for_constructor.info == NULL ||
-                 strcmp(g_base_info_get_name( (GIBaseInfo*) priv->info),
-                        g_base_info_get_name( (GIBaseInfo*) unthreadsafe_template_for_constructor.info))
-                 == 0);
-        unthreadsafe_template_for_constructor.info = NULL;
-
-        if (unthreadsafe_template_for_constructor.gobj == NULL) {
-            GParameter *params;
-            int n_params;
-
-            gtype = g_registered_type_info_get_g_type( (GIRegisteredTypeInfo*) priv->info);
-            if (gtype == G_TYPE_NONE) {
-                gjs_throw(context,
-                          "No GType for object '%s'???",
-                          g_base_info_get_name( (GIBaseInfo*) priv->info));
-                return JS_FALSE;
-            }
-
-            if (!object_instance_props_to_g_parameters(context, object, argc, argv,
-                                                       gtype,
-                                                       &params, &n_params)) {
-                return JS_FALSE;
-            }
+        gtype = g_registered_type_info_get_g_type( (GIRegisteredTypeInfo*) priv->proto_data->info);
+        if (gtype == G_TYPE_NONE) {
+            gjs_throw(context,
+                      "No GType for object '%s'???",
+                      g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
+            return JS_FALSE;
+        }
 
-            priv->gobj = g_object_newv(gtype, n_params, params);
-            free_g_params(params, n_params);
+        if (!object_instance_props_to_g_parameters(context, object, argc, argv,
+                                                   gtype,
+                                                   &params, &n_params)) {
+            return JS_FALSE;
+        }
 
-            if (G_IS_INITIALLY_UNOWNED(priv->gobj) &&
-                !g_object_is_floating(priv->gobj)) {
-                /* GtkWindow does not return a ref to caller of g_object_new.
-                 * Need a flag in gobject-introspection to tell us this.
-                 */
-                gjs_debug(GJS_DEBUG_GOBJECT,
-                          "Newly-created object is initially unowned but we did not get the "
-                          "floating ref, probably GtkWindow, using hacky workaround");
-                g_object_ref(priv->gobj);
-            } else if (g_object_is_floating(priv->gobj)) {
-                g_object_ref_sink(priv->gobj);
-            } else {
-                /* we should already have a ref */
-            }
-        } else {
-            priv->gobj = unthreadsafe_template_for_constructor.gobj;
-            unthreadsafe_template_for_constructor.gobj = NULL;
+        priv->gobj = g_object_newv(gtype, n_params, params);
+        free_g_params(params, n_params);
 
+        if (G_IS_INITIALLY_UNOWNED(priv->gobj) &&
+            !g_object_is_floating(priv->gobj)) {
+            /* GtkWindow does not return a ref to caller of g_object_new.
+             * Need a flag in gobject-introspection to tell us this.
+             */
+            gjs_debug(GJS_DEBUG_GOBJECT,
+                      "Newly-created object is initially unowned but we did not get the "
+                      "floating ref, probably GtkWindow, using hacky workaround");
+            g_object_ref(priv->gobj);
+        } else if (g_object_is_floating(priv->gobj)) {
             g_object_ref_sink(priv->gobj);
+        } else {
+            /* we should already have a ref */
         }
 
-        g_assert(peek_js_obj(context, priv->gobj) == NULL);
-        set_js_obj(context, priv->gobj, object);
+        associate_js_gobject(context, object, priv);
+    }
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(object_instance);
+
+    return JS_TRUE;
+}
+
+/* Links a new wrapper and the GObject in priv->gobj, which must hold
+ * a ref that gets converted to the toggle ref.
+ */
+static void
+associate_js_gobject(JSContext      *context,
+                     JSObject       *object,
+                     ObjectInstance *priv)
+{
+    g_assert(peek_js_obj(context, priv->gobj) == NULL);
+    set_js_obj(context, priv->gobj, object);
+
+    object_stats.wrappers += 1;
 
 #if DEBUG_DISPOSE
-        g_object_weak_ref(priv->gobj, wrapped_gobj_dispose_notify, object);
+    g_object_weak_ref(priv->gobj, wrapped_gobj_dispose_notify, object);
 #endif
 
-        /* OK, here is where things get complicated. We want the
-         * wrapped gobj to keep the JSObject* wrapper alive, because
-         * people might set properties on the JSObject* that they care
-         * about. Therefore, whenever the refcount on the wrapped gobj
-         * is >1, i.e. whenever something other than the wrapper is
-         * referencing the wrapped gobj, the wrapped gobj has a strong
-         * ref (gc-roots the wrapper). When the refcount on the
-         * wrapped gobj is 1, then we change to a weak ref to allow
-         * the wrapper to be garbage collected (and thus unref the
-         * wrappee).
-         */
-        priv->keep_alive = gjs_keep_alive_get_for_import_global(context);
-        gjs_keep_alive_add_child(context,
-                                 priv->keep_alive,
-                                 gobj_no_longer_kept_alive_func,
-                                 object,
-                                 priv);
-
-        g_object_add_toggle_ref(priv->gobj,
-                                wrapped_gobj_toggle_notify,
-                                JS_GetRuntime(context));
-
-        /* We now have both a ref and a toggle ref, we only want the
-         * toggle ref. This may immediately remove the GC root
-         * we just added, since refcount may drop to 1.
-         */
-        g_object_unref(priv->gobj);
+    /* OK, here is where things get complicated. We want the
+     * wrapped gobj to keep the JSObject* wrapper alive, because
+     * people might set properties on the JSObject* that they care
+     * about. Therefore, whenever the refcount on the wrapped gobj
+     * is >1, i.e. whenever something other than the wrapper is
+     * referencing the wrapped gobj, the wrapped gobj has a strong
+     * ref (gc-roots the wrapper). When the refcount on the
+     * wrapped gobj is 1, then we change to a weak ref to allow
+     * the wrapper to be garbage collected (and thus unref the
+     * wrappee).
+     */
+    priv->keep_alive = get_keep_alive_shard(context, priv);
+    gjs_keep_alive_add_child(context,
+                             priv->keep_alive,
+                             gobj_no_longer_kept_alive_func,
+                             object,
+                             priv);
+
+    g_object_add_toggle_ref(priv->gobj,
+                            wrapped_gobj_toggle_notify,
+                            JS_GetRuntime(context));
+
+    /* We now have both a ref and a toggle ref, we only want the
+     * toggle ref. This may immediately remove the GC root
+     * we just added, since refcount may drop to 1.
+     */
+    g_object_unref(priv->gobj);
 
-        gjs_debug_lifecycle(GJS_DEBUG_GOBJECT,
-                            "JSObject created with GObject %p %s",
-                            priv->gobj, g_type_name_from_instance((GTypeInstance*) priv->gobj));
+    gjs_debug_lifecycle(GJS_DEBUG_GOBJECT,
+                        "JSObject created with GObject %p %s",
+                        priv->gobj, g_type_name_from_instance((GTypeInstance*) priv->gobj));
 
-        TRACE(GJS_OBJECT_PROXY_NEW(priv, priv->gobj, g_base_info_get_namespace ( (GIBaseInfo*) priv->info),
-                                    g_base_info_get_name ( (GIBaseInfo*) priv->info) ));
-    }
+    TRACE(GJS_OBJECT_PROXY_NEW(priv, priv->gobj, g_base_info_get_namespace ( (GIBaseInfo*) priv->proto_data->info),
+                                g_base_info_get_name ( (GIBaseInfo*) priv->proto_data->info) ));
+}
 
-    GJS_NATIVE_CONSTRUCTOR_FINISH(object_instance);
+/* Wraps an existing GObject (from gjs_object_from_g_object()) without
+ * going through the JS constructor, which would need the GObject
+ * passed in through a global. @proto is the prototype for the object's
+ * type, which has the info.
+ */
+static JSObject*
+wrap_g_object(JSContext *context,
+              JSObject  *proto,
+              GObject   *gobj)
+{
+    JSObject *object;
+    ObjectInstance *priv;
+    ObjectInstance *proto_priv;
 
-    return JS_TRUE;
+    proto_priv = priv_from_js(context, proto);
+    g_assert(proto_priv != NULL);
+
+    object = JS_NewObject(context, JS_GET_CLASS(context, proto), proto,
+                          gjs_get_import_global(context));
+    if (object == NULL)
+        return NULL;
+
+    priv = g_slice_new0(ObjectInstance);
+
+    GJS_INC_COUNTER(object);
+
+    g_assert(priv_from_js(context, object) == NULL);
+    JS_SetPrivate(context, object, priv);
+
+    gjs_debug_lifecycle(GJS_DEBUG_GOBJECT,
+                        "wrapping gobj %p in obj %p priv %p", gobj, object, priv);
+
+    priv->proto_data = object_prototype_ref(proto_priv->proto_data);
+
+    priv->gobj = gobj;
+    g_object_ref_sink(priv->gobj);
+
+    associate_js_gobject(context, object, priv);
+
+    return object;
 }
 
 static void
@@ -779,6 +1332,7 @@ object_instance_finalize(JSContext *context,
                          JSObject  *obj)
 {
     ObjectInstance *priv;
+    gboolean is_proto;
 
     priv = priv_from_js(context, obj);
     gjs_debug_lifecycle(GJS_DEBUG_GOBJECT,
@@ -790,15 +1344,19 @@ object_instance_finalize(JSContext *context,
     if (priv == NULL)
         return; /* we are the prototype, not a real instance, so constructor never called */
 
-    TRACE(GJS_OBJECT_PROXY_FINALIZE(priv, priv->gobj, g_base_info_get_namespace ( (GIBaseInfo*) priv->info),
-                                    g_base_info_get_name ( (GIBaseInfo*) priv->info) ));
+    is_proto = priv->gobj == NULL;
 
     if (priv->gobj) {
+        TRACE(GJS_OBJECT_PROXY_FINALIZE(priv, priv->gobj, g_base_info_get_namespace ( (GIBaseInfo*) priv->proto_data->info),
+                                        g_base_info_get_name ( (GIBaseInfo*) priv->proto_data->info) ));
+
         if (G_UNLIKELY (priv->gobj->ref_count <= 0)) {
             g_error("Finalizing proxy for an already freed object of type: %s.%s\n",
-                    g_base_info_get_namespace((GIBaseInfo*) priv->info),
-                    g_base_info_get_name((GIBaseInfo*) priv->info));
+                    g_base_info_get_namespace((GIBaseInfo*) priv->proto_data->info),
+                    g_base_info_get_name((GIBaseInfo*) priv->proto_data->info));
         }
+        if (priv->toggle_queued)
+            toggle_queue_remove(JS_GetRuntime(context), priv);
         set_js_obj(context, priv->gobj, NULL);
         g_object_remove_toggle_ref(priv->gobj, wrapped_gobj_toggle_notify,
                                    JS_GetRuntime(context));
@@ -827,26 +1385,196 @@ object_instance_finalize(JSContext *context,
                                     priv);
     }
 
-    if (priv->info) {
-        g_base_info_unref( (GIBaseInfo*) priv->info);
-        priv->info = NULL;
+    if (priv->proto_data) {
+        if (is_proto)
+            forget_prototype(context, obj, priv->proto_data->gtype);
+        else
+            object_stats.wrappers -= 1;
+
+        object_prototype_unref(priv->proto_data);
+        priv->proto_data = NULL;
     }
 
     GJS_DEC_COUNTER(object);
     g_slice_free(ObjectInstance, priv);
 }
 
+/* Prototypes by GType, per runtime, so that wrapping objects and
+ * looking up parent prototypes skips g_irepository_find_by_gtype()
+ * and the namespace lookups in gjs_define_object_class(). Entries
+ * aren't rooted; they are removed when the prototype is finalized.
+ */
+GJS_DEFINE_QUARK(gjs-gi-object-prototypes, prototypes)
+
+static void
+forget_prototype(JSContext *context,
+                 JSObject  *proto,
+                 GType      gtype)
+{
+    GHashTable *prototypes;
+
+    prototypes = gjs_runtime_get_data(JS_GetRuntime(context), prototypes_quark());
+    if (prototypes != NULL &&
+        g_hash_table_lookup(prototypes, (gpointer) gtype) == proto)
+        g_hash_table_remove(prototypes, (gpointer) gtype);
+}
+
 JSObject*
 gjs_lookup_object_prototype(JSContext    *context,
                             GType         gtype)
 {
+    JSRuntime *runtime;
+    GHashTable *prototypes;
     JSObject *proto;
 
+    runtime = JS_GetRuntime(context);
+    prototypes = gjs_runtime_get_data(runtime, prototypes_quark());
+    if (prototypes == NULL) {
+        prototypes = g_hash_table_new(g_direct_hash, g_direct_equal);
+        gjs_runtime_set_data(runtime, prototypes_quark(), prototypes,
+                             (GDestroyNotify) g_hash_table_destroy);
+    }
+
+    proto = g_hash_table_lookup(prototypes, (gpointer) gtype);
+    if (proto != NULL)
+        return proto;
+
     if (!gjs_define_object_class(context, NULL, gtype, NULL, &proto, NULL))
         return NULL;
+
+    g_hash_table_insert(prototypes, (gpointer) gtype, proto);
     return proto;
 }
 
+/* Signals looked up by emit() and connect(), per GType: GType =>
+ * (detailed signal name => SignalInfo). Like the method cache, this is
+ * never freed; signal ids and the param types array from
+ * g_signal_query() stay valid as long as the type is registered.
+ */
+typedef struct {
+    guint signal_id;
+    GQuark signal_detail;
+    GSignalQuery query;
+} SignalInfo;
+
+static GHashTable *signal_caches = NULL;
+
+#define SIGNAL_NAME_BUF_LEN 64
+
+/* Gets @value as an ASCII string into @buf if it fits, which saves an
+ * allocation for all realistic signal names. Returns NULL with an
+ * exception set on failure, otherwise @buf or a string to g_free().
+ */
+static char*
+get_signal_name(JSContext *context,
+                jsval      value,
+                char      *buf)
+{
+#ifdef HAVE_JS_GETSTRINGBYTES
+    return gjs_string_get_ascii(context, value);
+#else
+    JSString *str;
+    size_t len;
+
+    str = JSVAL_TO_STRING(value);
+    len = JS_GetStringEncodingLength(context, str);
+    if (len == (size_t)(-1))
+        return NULL;
+
+    if (len >= SIGNAL_NAME_BUF_LEN)
+        return gjs_string_get_ascii(context, value);
+
+    JS_EncodeStringToBuffer(str, buf, len);
+    buf[len] = '\0';
+    return buf;
+#endif
+}
+
+static SignalInfo*
+lookup_signal(JSContext *context,
+              GObject   *gobj,
+              jsval      name_value)
+{
+    char buf[SIGNAL_NAME_BUF_LEN];
+    char *signal_name;
+    GType gtype;
+    GHashTable *signals;
+    SignalInfo *signal;
+
+    signal_name = get_signal_name(context, name_value, buf);
+    if (signal_name == NULL)
+        return NULL;
+
+    gtype = G_OBJECT_TYPE(gobj);
+
+    if (G_UNLIKELY(signal_caches == NULL))
+        signal_caches = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    signals = g_hash_table_lookup(signal_caches, (gpointer) gtype);
+    if (signals == NULL) {
+        signals = g_hash_table_new(g_str_hash, g_str_equal);
+        g_hash_table_insert(signal_caches, (gpointer) gtype, signals);
+    }
+
+    signal = g_hash_table_lookup(signals, signal_name);
+    if (signal != NULL)
+        goto out;
+
+    signal = g_slice_new0(SignalInfo);
+    if (!g_signal_parse_name(signal_name,
+                             gtype,
+                             &signal->signal_id,
+                             &signal->signal_detail,
+                             FALSE)) {
+        gjs_throw(context, "No signal '%s' on object '%s'",
+                     signal_name,
+                     g_type_name(gtype));
+        g_slice_free(SignalInfo, signal);
+        signal = NULL;
+        goto out;
+    }
+
+    g_signal_query(signal->signal_id, &signal->query);
+    g_hash_table_insert(signals, g_strdup(signal_name), signal);
+
+ out:
+    if (signal_name != buf)
+        g_free(signal_name);
+    return signal;
+}
+
+/* GValues for emit(), per runtime, used as a stack so that emissions
+ * from signal handlers nest; emissions with more arguments than fit
+ * fall back to the C stack. Unused slots are always zeroed
+ * (g_value_unset() clears them), so nothing has to be reset between
+ * emissions.
+ */
+#define EMIT_VALUES_LEN 64
+
+typedef struct {
+    guint used;
+    GValue values[EMIT_VALUES_LEN];
+} EmitValues;
+
+GJS_DEFINE_QUARK(gjs-gi-object-emit-values, emit_values)
+
+static EmitValues*
+get_emit_values(JSContext *context)
+{
+    JSRuntime *runtime;
+    EmitValues *emit_values;
+
+    runtime = JS_GetRuntime(context);
+    emit_values = gjs_runtime_get_data(runtime, emit_values_quark());
+    if (G_LIKELY(emit_values != NULL))
+        return emit_values;
+
+    emit_values = g_new0(EmitValues, 1);
+    gjs_runtime_set_data(runtime, emit_values_quark(), emit_values, g_free);
+
+    return emit_values;
+}
+
 static JSBool
 real_connect_func(JSContext *context,
                   uintN      argc,
@@ -858,11 +1586,8 @@ real_connect_func(JSContext *context,
     ObjectInstance *priv;
     GClosure *closure;
     gulong id;
-    guint signal_id;
-    char *signal_name;
-    GQuark signal_detail;
+    SignalInfo *signal;
     jsval retval;
-    JSBool ret = JS_FALSE;
 
     priv = priv_from_js(context, obj);
     gjs_debug_gsignal("connect obj %p priv %p argc %d", obj, priv, argc);
@@ -871,8 +1596,8 @@ real_connect_func(JSContext *context,
     if (priv->gobj == NULL) {
         /* prototype, not an instance. */
         gjs_throw(context, "Can't connect to signals on %s.%s.prototype; only on instances",
-                     g_base_info_get_namespace( (GIBaseInfo*) priv->info),
-                     g_base_info_get_name( (GIBaseInfo*) priv->info));
+                     g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+                     g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
         return JS_FALSE;
     }
 
@@ -889,42 +1614,29 @@ real_connect_func(JSContext *context,
         return JS_FALSE;
     }
 
-    signal_name = gjs_string_get_ascii(context, argv[0]);
-    if (signal_name == NULL) {
+    signal = lookup_signal(context, priv->gobj, argv[0]);
+    if (signal == NULL)
         return JS_FALSE;
-    }
 
-    if (!g_signal_parse_name(signal_name,
-                             G_OBJECT_TYPE(priv->gobj),
-                             &signal_id,
-                             &signal_detail,
-                             FALSE)) {
-        gjs_throw(context, "No signal '%s' on object '%s'",
-                     signal_name,
-                     g_type_name(G_OBJECT_TYPE(priv->gobj)));
-        goto out;
-    }
-
-    closure = gjs_closure_new_for_signal(context, JSVAL_TO_OBJECT(argv[1]), "signal callback", signal_id);
+    closure = gjs_closure_new_for_signal(context, JSVAL_TO_OBJECT(argv[1]), "signal callback",
+                                         signal->signal_id);
     if (closure == NULL)
-        goto out;
+        return JS_FALSE;
 
-    id = g_signal_connect_closure(priv->gobj,
-                                  signal_name,
-                                  closure,
-                                  after);
+    id = g_signal_connect_closure_by_id(priv->gobj,
+                                        signal->signal_id,
+                                        signal->signal_detail,
+                                        closure,
+                                        after);
 
     if (!JS_NewNumberValue(context, id, &retval)) {
         g_signal_handler_disconnect(priv->gobj, id);
-        goto out;
+        return JS_FALSE;
     }
     
     JS_SET_RVAL(context, vp, retval);
 
-    ret = JS_TRUE;
- out:
-    g_free(signal_name);
-    return ret;
+    return JS_TRUE;
 }
 
 static JSBool
@@ -962,8 +1674,8 @@ disconnect_func(JSContext *context,
     if (priv->gobj == NULL) {
         /* prototype, not an instance. */
         gjs_throw(context, "Can't disconnect signal on %s.%s.prototype; only on instances",
-                     g_base_info_get_namespace( (GIBaseInfo*) priv->info),
-                     g_base_info_get_name( (GIBaseInfo*) priv->info));
+                     g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+                     g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
         return JS_FALSE;
     }
 
@@ -990,16 +1702,15 @@ emit_func(JSContext *context,
     jsval *argv = JS_ARGV(context, vp);
     JSObject *obj = JS_THIS_OBJECT(context, vp);
     ObjectInstance *priv;
-    guint signal_id;
-    GQuark signal_detail;
-    GSignalQuery signal_query;
-    char *signal_name;
+    SignalInfo *signal;
+    GSignalQuery *signal_query;
     GValue *instance_and_args;
-    GValue rvalue;
-    unsigned int i;
+    GValue rvalue = { 0, };
+    unsigned int i, n_values, n_initialized;
+    EmitValues *emit_values;
+    gboolean use_emit_values;
     gboolean failed;
     jsval retval;
-    JSBool ret = JS_FALSE;
 
     priv = priv_from_js(context, obj);
     gjs_debug_gsignal("emit obj %p priv %p argc %d", obj, priv, argc);
@@ -1010,8 +1721,8 @@ emit_func(JSContext *context,
     if (priv->gobj == NULL) {
         /* prototype, not an instance. */
         gjs_throw(context, "Can't emit signal on %s.%s.prototype; only on instances",
-                     g_base_info_get_namespace( (GIBaseInfo*) priv->info),
-                     g_base_info_get_name( (GIBaseInfo*) priv->info));
+                     g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+                     g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
         return JS_FALSE;
     }
 
@@ -1021,50 +1732,48 @@ emit_func(JSContext *context,
         return JS_FALSE;
     }
 
-    signal_name = gjs_string_get_ascii(context,
-                                                  argv[0]);
-    if (signal_name == NULL)
+    signal = lookup_signal(context, priv->gobj, argv[0]);
+    if (signal == NULL)
         return JS_FALSE;
 
-    if (!g_signal_parse_name(signal_name,
-                             G_OBJECT_TYPE(priv->gobj),
-                             &signal_id,
-                             &signal_detail,
-                             FALSE)) {
-        gjs_throw(context, "No signal '%s' on object '%s'",
-                     signal_name,
-                     g_type_name(G_OBJECT_TYPE(priv->gobj)));
-        goto out;
-    }
-
-    g_signal_query(signal_id, &signal_query);
+    signal_query = &signal->query;
 
-    if ((argc - 1) != signal_query.n_params) {
+    if ((argc - 1) != signal_query->n_params) {
         gjs_throw(context, "Signal '%s' on %s requires %d args got %d",
-                     signal_name,
+                     signal_query->signal_name,
                      g_type_name(G_OBJECT_TYPE(priv->gobj)),
-                     signal_query.n_params,
+                     signal_query->n_params,
                      argc - 1);
-        goto out;
+        return JS_FALSE;
     }
 
-    if (signal_query.return_type != G_TYPE_NONE) {
-        g_value_init(&rvalue, signal_query.return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+    if (signal_query->return_type != G_TYPE_NONE) {
+        g_value_init(&rvalue, signal_query->return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
     }
 
-    instance_and_args = g_newa(GValue, signal_query.n_params + 1);
-    memset(instance_and_args, 0, sizeof(GValue) * (signal_query.n_params + 1));
+    n_values = signal_query->n_params + 1;
+    emit_values = get_emit_values(context);
+    use_emit_values = emit_values->used + n_values <= EMIT_VALUES_LEN;
+    if (use_emit_values) {
+        instance_and_args = &emit_values->values[emit_values->used];
+        emit_values->used += n_values;
+    } else {
+        instance_and_args = g_newa(GValue, n_values);
+        memset(instance_and_args, 0, sizeof(GValue) * n_values);
+    }
 
     g_value_init(&instance_and_args[0], G_TYPE_FROM_INSTANCE(priv->gobj));
     g_value_set_instance(&instance_and_args[0], priv->gobj);
+    n_initialized = 1;
 
     failed = FALSE;
-    for (i = 0; i < signal_query.n_params; ++i) {
+    for (i = 0; i < signal_query->n_params; ++i) {
         GValue *value;
         value = &instance_and_args[i + 1];
 
-        g_value_init(value, signal_query.param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
-        if ((signal_query.param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0)
+        g_value_init(value, signal_query->param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+        n_initialized += 1;
+        if ((signal_query->param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0)
             failed = !gjs_value_to_g_value_no_copy(context, argv[i+1], value);
         else
             failed = !gjs_value_to_g_value(context, argv[i+1], value);
@@ -1074,30 +1783,33 @@ emit_func(JSContext *context,
     }
 
     if (!failed) {
-        g_signal_emitv(instance_and_args, signal_id, signal_detail,
+        g_signal_emitv(instance_and_args, signal->signal_id, signal->signal_detail,
                        &rvalue);
     }
 
-    if (signal_query.return_type != G_TYPE_NONE) {
-        if (!gjs_value_from_g_value(context,
-                                       &retval,
-                                       &rvalue))
+    if (signal_query->return_type != G_TYPE_NONE) {
+        if (!failed &&
+            !gjs_value_from_g_value(context,
+                                    &retval,
+                                    &rvalue))
             failed = TRUE;
 
         g_value_unset(&rvalue);
+    } else {
+        retval = JSVAL_VOID;
     }
 
-    for (i = 0; i < (signal_query.n_params + 1); ++i) {
+    for (i = 0; i < n_initialized; ++i) {
         g_value_unset(&instance_and_args[i]);
     }
 
+    if (use_emit_values)
+        emit_values->used -= n_values;
+
     if (!failed)
         JS_SET_RVAL(context, vp, retval);
 
-    ret = !failed;
- out:
-    g_free(signal_name);
-    return ret;
+    return !failed;
 }
 
 /* Default spidermonkey toString is worthless.  Replace it
@@ -1122,8 +1834,8 @@ to_string_func(JSContext *context,
     if (priv == NULL)
         return JS_FALSE; /* wrong class passed in */
 
-    namespace = g_base_info_get_namespace( (GIBaseInfo*) priv->info);
-    name = g_base_info_get_name( (GIBaseInfo*) priv->info);
+    namespace = g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info);
+    name = g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info);
 
     if (priv->gobj == NULL) {
         strval = g_strdup_printf ("[object prototype of GIName:%s.%s jsobj@%p]", namespace, name, obj);
@@ -1400,10 +2112,14 @@ gjs_define_object_class(JSContext     *context,
     /* Put the info in the prototype */
     priv = priv_from_js(context, prototype);
     g_assert(priv != NULL);
-    g_assert(priv->info == NULL);
-    priv->info = info;
-    g_base_info_ref( (GIBaseInfo*) priv->info);
-    priv->gtype = gtype;
+    g_assert(priv->proto_data == NULL);
+    priv->proto_data = g_slice_new0(ObjectPrototype);
+    priv->proto_data->ref_count = 1;
+    object_stats.prototypes += 1;
+    init_object_stats();
+    priv->proto_data->info = info;
+    g_base_info_ref( (GIBaseInfo*) priv->proto_data->info);
+    priv->proto_data->gtype = gtype;
 
     gjs_debug(GJS_DEBUG_GOBJECT, "Defined class %s prototype %p class %p in object %p",
               constructor_name, prototype, JS_GET_CLASS(context, prototype), in_object);
@@ -1438,55 +2154,46 @@ gjs_define_object_class(JSContext     *context,
     return TRUE;
 }
 
-/* multiple JSRuntime could have a proxy to the same GObject, in theory
+/* multiple JSRuntime could have a proxy to the same GObject, in theory,
+ * so the wrapper is stored in qdata under a quark specific to the runtime.
  */
-#define OBJ_KEY_PREFIX_LEN 3
-#define OBJ_KEY_LEN (OBJ_KEY_PREFIX_LEN+sizeof(void*)*2)
-static void
-get_obj_key(JSRuntime *runtime,
-            char      *buf)
+GJS_DEFINE_QUARK(gjs-gi-object-wrapper-quark, obj_quark_data)
+
+static GQuark
+get_obj_quark(JSRuntime *runtime)
 {
     /* not thread safe, but that's fine for now - just nuke the
      * cache thingy if we ever need thread safety
      */
-    static char cached_buf[OBJ_KEY_LEN+1];
     static JSRuntime *cached_for = NULL;
+    static GQuark cached_quark = 0;
+    GQuark quark;
 
-    if (cached_for != runtime) {
-        unsigned int i;
-        union {
-            const unsigned char bytes[sizeof(void*)];
-            void *ptr;
-        } d;
-        g_assert(sizeof(d) == sizeof(void*));
-
-        buf[0] = 'j';
-        buf[1] = 's';
-        buf[2] = '-';
-        d.ptr = runtime;
-        for (i = 0; i < sizeof(void*); i++) {
-                int offset = OBJ_KEY_PREFIX_LEN+(i*2);
-                buf[offset] = 'a' + ((d.bytes[i] & 0xf0) >> 4);
-                buf[offset+1] = 'a' + (d.bytes[i] & 0x0f);
-        }
-        buf[OBJ_KEY_LEN] = '\0';
-        strcpy(cached_buf, buf);
-        cached_for = runtime;
-        g_assert(strlen(buf) == OBJ_KEY_LEN);
-    } else {
-        strcpy(buf, cached_buf);
+    if (G_LIKELY(cached_for == runtime))
+        return cached_quark;
+
+    quark = GPOINTER_TO_UINT(gjs_runtime_get_data(runtime, obj_quark_data_quark()));
+    if (quark == 0) {
+        char *key;
+
+        key = g_strdup_printf("js-%p", runtime);
+        quark = g_quark_from_string(key);
+        g_free(key);
+
+        gjs_runtime_set_data(runtime, obj_quark_data_quark(), GUINT_TO_POINTER(quark), NULL);
     }
+
+    cached_for = runtime;
+    cached_quark = quark;
+
+    return quark;
 }
 
 static JSObject*
 peek_js_obj(JSContext *context,
             GObject   *gobj)
 {
-    char buf[OBJ_KEY_LEN+1];
-
-    get_obj_key(JS_GetRuntime(context), buf);
-
-    return g_object_get_data(gobj, buf);
+    return g_object_get_qdata(gobj, get_obj_quark(JS_GetRuntime(context)));
 }
 
 static void
@@ -1494,11 +2201,7 @@ set_js_obj(JSContext *context,
            GObject   *gobj,
            JSObject  *obj)
 {
-    char buf[OBJ_KEY_LEN+1];
-
-    get_obj_key(JS_GetRuntime(context), buf);
-
-    g_object_set_data(gobj, buf, obj);
+    g_object_set_qdata(gobj, get_obj_quark(JS_GetRuntime(context)), obj);
 }
 
 JSObject*
@@ -1515,25 +2218,18 @@ gjs_object_from_g_object(JSContext    *context,
     if (obj == NULL) {
         /* We have to create a wrapper */
         JSObject *proto;
-        GIObjectInfo *info;
 
         gjs_debug_marshal(GJS_DEBUG_GOBJECT,
                           "Wrapping %s with JSObject",
                           g_type_name_from_instance((GTypeInstance*) gobj));
 
-
-        if (!gjs_define_object_class(context, NULL, G_TYPE_FROM_INSTANCE(gobj), NULL, &proto, &info))
+        proto = gjs_lookup_object_prototype(context, G_TYPE_FROM_INSTANCE(gobj));
+        if (proto == NULL)
             return NULL;
-        /* can't come up with a better approach... */
-        unthreadsafe_template_for_constructor.info = (GIObjectInfo*) info;
-        unthreadsafe_template_for_constructor.gobj = gobj;
-
-        obj = gjs_construct_object_dynamic(context, proto,
-                                              0, NULL);
 
-        g_base_info_unref( (GIBaseInfo*) info);
+        obj = wrap_g_object(context, proto, gobj);
 
-        g_assert(peek_js_obj(context, gobj) == obj);
+        g_assert(obj == NULL || peek_js_obj(context, gobj) == obj);
     }
 
     return obj;
@@ -1556,8 +2252,8 @@ gjs_g_object_from_object(JSContext    *context,
     if (priv->gobj == NULL) {
         gjs_throw(context,
                   "Object is %s.%s.prototype, not an object instance - cannot convert to GObject*",
-                  g_base_info_get_namespace( (GIBaseInfo*) priv->info),
-                  g_base_info_get_name( (GIBaseInfo*) priv->info));
+                  g_base_info_get_namespace( (GIBaseInfo*) priv->proto_data->info),
+                  g_base_info_get_name( (GIBaseInfo*) priv->proto_data->info));
         return NULL;
     }
 
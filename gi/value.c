@@ -48,6 +48,293 @@ static JSBool gjs_value_from_g_value_internal(JSContext    *context,
                                               GSignalQuery *signal_query,
                                               gint          arg_n);
 
+/* Which conversion a GType gets, i.e. which branch of
+ * gjs_value_to_g_value_internal() and gjs_value_from_g_value_internal()
+ * applies to it. Types not handled by one direction are converted
+ * through GValue transformations, if possible.
+ */
+typedef enum {
+    VALUE_KIND_UNKNOWN = 0,
+    VALUE_KIND_STRING,
+    VALUE_KIND_CHAR,
+    VALUE_KIND_UCHAR,
+    VALUE_KIND_INT,
+    VALUE_KIND_UINT,
+    VALUE_KIND_DOUBLE,
+    VALUE_KIND_FLOAT,
+    VALUE_KIND_BOOLEAN,
+    VALUE_KIND_OBJECT,
+    VALUE_KIND_STRV,
+    VALUE_KIND_CONTAINER, /* boxed GHashTable and arrays */
+    VALUE_KIND_BOXED,
+    VALUE_KIND_ENUM,
+    VALUE_KIND_FLAGS,
+    VALUE_KIND_PARAM,
+    VALUE_KIND_POINTER,
+    VALUE_KIND_OTHER
+} ValueKind;
+
+static ValueKind
+classify_g_type(GType gtype)
+{
+    if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE))
+        return VALUE_KIND_OBJECT;
+    else if (gtype == G_TYPE_STRV)
+        return VALUE_KIND_STRV;
+    else if (g_type_is_a(gtype, G_TYPE_HASH_TABLE) ||
+             g_type_is_a(gtype, _array_type) ||
+             g_type_is_a(gtype, _byte_array_type) ||
+             g_type_is_a(gtype, _ptr_array_type))
+        return VALUE_KIND_CONTAINER;
+    else if (g_type_is_a(gtype, G_TYPE_BOXED))
+        return VALUE_KIND_BOXED;
+    else if (g_type_is_a(gtype, G_TYPE_ENUM))
+        return VALUE_KIND_ENUM;
+    else if (g_type_is_a(gtype, G_TYPE_FLAGS))
+        return VALUE_KIND_FLAGS;
+    else if (g_type_is_a(gtype, G_TYPE_PARAM))
+        return VALUE_KIND_PARAM;
+    else if (g_type_is_a(gtype, G_TYPE_POINTER))
+        return VALUE_KIND_POINTER;
+    else
+        return VALUE_KIND_OTHER;
+}
+
+/* Derived types are classified with g_type_is_a() once and looked up
+ * afterwards; types can't be unregistered, so entries never go stale.
+ */
+static GHashTable *value_kinds = NULL;
+
+static ValueKind
+get_value_kind(GType gtype)
+{
+    ValueKind kind;
+
+    switch (gtype) {
+    case G_TYPE_STRING:
+        return VALUE_KIND_STRING;
+    case G_TYPE_CHAR:
+        return VALUE_KIND_CHAR;
+    case G_TYPE_UCHAR:
+        return VALUE_KIND_UCHAR;
+    case G_TYPE_INT:
+        return VALUE_KIND_INT;
+    case G_TYPE_UINT:
+        return VALUE_KIND_UINT;
+    case G_TYPE_DOUBLE:
+        return VALUE_KIND_DOUBLE;
+    case G_TYPE_FLOAT:
+        return VALUE_KIND_FLOAT;
+    case G_TYPE_BOOLEAN:
+        return VALUE_KIND_BOOLEAN;
+    default:
+        break;
+    }
+
+    if (value_kinds == NULL)
+        value_kinds = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    kind = GPOINTER_TO_INT(g_hash_table_lookup(value_kinds, GSIZE_TO_POINTER(gtype)));
+    if (kind == VALUE_KIND_UNKNOWN) {
+        kind = classify_g_type(gtype);
+        g_hash_table_insert(value_kinds, GSIZE_TO_POINTER(gtype), GINT_TO_POINTER(kind));
+    }
+
+    return kind;
+}
+
+typedef JSBool (* GjsValueFromGValueFunc) (JSContext    *context,
+                                            jsval        *value_p,
+                                            const GValue *gvalue);
+
+static JSBool
+value_from_string(JSContext    *context,
+                  jsval        *value_p,
+                  const GValue *gvalue)
+{
+    const char *v;
+
+    v = g_value_get_string(gvalue);
+    if (v == NULL) {
+        *value_p = JSVAL_NULL;
+        return JS_TRUE;
+    }
+    return gjs_string_from_utf8(context, v, -1, value_p);
+}
+
+static JSBool
+value_from_int(JSContext    *context,
+               jsval        *value_p,
+               const GValue *gvalue)
+{
+    return JS_NewNumberValue(context, g_value_get_int(gvalue), value_p);
+}
+
+static JSBool
+value_from_uint(JSContext    *context,
+                jsval        *value_p,
+                const GValue *gvalue)
+{
+    return JS_NewNumberValue(context, g_value_get_uint(gvalue), value_p);
+}
+
+static JSBool
+value_from_double(JSContext    *context,
+                  jsval        *value_p,
+                  const GValue *gvalue)
+{
+    return JS_NewNumberValue(context, g_value_get_double(gvalue), value_p);
+}
+
+static JSBool
+value_from_float(JSContext    *context,
+                 jsval        *value_p,
+                 const GValue *gvalue)
+{
+    return JS_NewNumberValue(context, g_value_get_float(gvalue), value_p);
+}
+
+static JSBool
+value_from_boolean(JSContext    *context,
+                   jsval        *value_p,
+                   const GValue *gvalue)
+{
+    *value_p = BOOLEAN_TO_JSVAL(g_value_get_boolean(gvalue));
+    return JS_TRUE;
+}
+
+static JSBool
+value_from_object(JSContext    *context,
+                  jsval        *value_p,
+                  const GValue *gvalue)
+{
+    JSObject *obj;
+
+    obj = gjs_object_from_g_object(context, g_value_get_object(gvalue));
+    *value_p = OBJECT_TO_JSVAL(obj);
+    return JS_TRUE;
+}
+
+/* Converters for the types that signals mostly use; returns NULL for
+ * types needing gjs_value_from_g_value_internal().
+ */
+static GjsValueFromGValueFunc
+get_signal_param_converter(GType gtype)
+{
+    switch (get_value_kind(gtype)) {
+    case VALUE_KIND_STRING:
+        return value_from_string;
+    case VALUE_KIND_INT:
+        return value_from_int;
+    case VALUE_KIND_UINT:
+        return value_from_uint;
+    case VALUE_KIND_DOUBLE:
+        return value_from_double;
+    case VALUE_KIND_FLOAT:
+        return value_from_float;
+    case VALUE_KIND_BOOLEAN:
+        return value_from_boolean;
+    case VALUE_KIND_OBJECT:
+        return value_from_object;
+    default:
+        return NULL;
+    }
+}
+
+/* How to convert the parameters of one signal, computed once and
+ * passed to closure_marshal() as the marshal data. Like signal ids,
+ * these are never freed.
+ */
+typedef struct {
+    GType gtype;
+    gboolean no_copy;
+    GjsValueFromGValueFunc convert; /* NULL for the generic path */
+} GjsSignalParam;
+
+typedef struct {
+    GSignalQuery query;
+    guint n_values; /* parameters + instance */
+    GjsSignalParam *params; /* n_values, the instance first */
+} GjsSignalMarshaller;
+
+static GHashTable *signal_marshallers = NULL;
+
+static GjsSignalMarshaller*
+get_signal_marshaller(guint signal_id)
+{
+    GjsSignalMarshaller *marshaller;
+    guint i;
+
+    if (signal_marshallers == NULL)
+        signal_marshallers = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    marshaller = g_hash_table_lookup(signal_marshallers, GUINT_TO_POINTER(signal_id));
+    if (marshaller != NULL)
+        return marshaller;
+
+    marshaller = g_slice_new0(GjsSignalMarshaller);
+    g_signal_query(signal_id, &marshaller->query);
+
+    if (marshaller->query.signal_id == 0) {
+        g_slice_free(GjsSignalMarshaller, marshaller);
+        return NULL;
+    }
+
+    marshaller->n_values = marshaller->query.n_params + 1;
+    marshaller->params = g_new0(GjsSignalParam, marshaller->n_values);
+
+    marshaller->params[0].gtype = marshaller->query.itype;
+    marshaller->params[0].convert = get_signal_param_converter(marshaller->query.itype);
+
+    for (i = 1; i < marshaller->n_values; i++) {
+        GType param_type = marshaller->query.param_types[i - 1];
+        GjsSignalParam *param = &marshaller->params[i];
+
+        param->gtype = param_type & ~G_SIGNAL_TYPE_STATIC_SCOPE;
+        param->no_copy = (param_type & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
+        param->convert = get_signal_param_converter(param->gtype);
+    }
+
+    g_hash_table_insert(signal_marshallers, GUINT_TO_POINTER(signal_id), marshaller);
+
+    return marshaller;
+}
+
+/* A stack of jsvals for marshalled arguments, per runtime, whose slots
+ * are added as GC roots once when it is created rather than on every
+ * call. Nested emissions take the next slots; a call that doesn't fit
+ * roots its own arguments instead. Slots are reset to JSVAL_VOID after
+ * each call so they don't keep anything alive. The roots go away with
+ * the runtime.
+ */
+#define MARSHAL_STACK_SIZE 256
+
+typedef struct {
+    guint used;
+    jsval values[MARSHAL_STACK_SIZE];
+} MarshalStack;
+
+GJS_DEFINE_QUARK(gjs-gi-marshal-stack, marshal_stack)
+
+static MarshalStack*
+get_marshal_stack(JSContext *context)
+{
+    JSRuntime *runtime;
+    MarshalStack *stack;
+
+    runtime = JS_GetRuntime(context);
+    stack = gjs_runtime_get_data(runtime, marshal_stack_quark());
+    if (G_LIKELY(stack != NULL))
+        return stack;
+
+    stack = g_new0(MarshalStack, 1);
+    gjs_set_values(context, stack->values, MARSHAL_STACK_SIZE, JSVAL_VOID);
+    gjs_root_value_locations(context, stack->values, MARSHAL_STACK_SIZE);
+    gjs_runtime_set_data(runtime, marshal_stack_quark(), stack, g_free);
+
+    return stack;
+}
+
 static void
 closure_marshal(GClosure        *closure,
                 GValue          *return_value,
@@ -58,11 +345,13 @@ closure_marshal(GClosure        *closure,
 {
     JSRuntime *runtime;
     JSContext *context;
+    GjsSignalMarshaller *marshaller;
+    MarshalStack *stack;
+    GjsClosureDispatch dispatch;
     int argc;
     jsval *argv;
-    jsval rval;
+    jsval *rval;
     int i;
-    GSignalQuery signal_query = { 0, };
 
     gjs_debug_marshal(GJS_DEBUG_GCLOSURE,
                       "Marshal closure %p",
@@ -75,48 +364,52 @@ closure_marshal(GClosure        *closure,
 
     runtime = gjs_closure_get_runtime(closure);
     context = gjs_runtime_get_current_context(runtime);
-    JS_BeginRequest(context);
-
-    argc = n_param_values;
-    argv = g_newa(jsval, n_param_values);
-    rval = JSVAL_VOID;
+    gjs_closure_begin_dispatch(&dispatch, context);
 
-    gjs_set_values(context, argv, argc, JSVAL_VOID);
-    gjs_root_value_locations(context, argv, argc);
-    JS_AddValueRoot(context, &rval);
+    /* we are used for a signal handler if we have marshal_data */
+    marshaller = marshal_data;
 
-    if (marshal_data) {
-        /* we are used for a signal handler */
-        guint signal_id;
-
-        signal_id = GPOINTER_TO_UINT(marshal_data);
-
-        g_signal_query(signal_id, &signal_query);
+    argc = n_param_values;
 
-        if (!signal_query.signal_id) {
-            gjs_debug(GJS_DEBUG_GCLOSURE,
-                      "Signal handler being called on invalid signal");
-            goto cleanup;
-        }
+    /* argv, then the return value */
+    stack = get_marshal_stack(context);
+    if (stack->used + argc + 1 <= MARSHAL_STACK_SIZE) {
+        argv = &stack->values[stack->used];
+        stack->used += argc + 1;
+    } else {
+        stack = NULL;
+        argv = g_newa(jsval, argc + 1);
+        gjs_set_values(context, argv, argc + 1, JSVAL_VOID);
+        gjs_root_value_locations(context, argv, argc + 1);
+    }
+    rval = &argv[argc];
 
-        if (signal_query.n_params + 1 != n_param_values) {
-            gjs_debug(GJS_DEBUG_GCLOSURE,
-                      "Signal handler being called with wrong number of parameters");
-            goto cleanup;
-        }
+    if (marshaller != NULL &&
+        marshaller->n_values != n_param_values) {
+        gjs_debug(GJS_DEBUG_GCLOSURE,
+                  "Signal handler being called with wrong number of parameters");
+        goto cleanup;
     }
 
     for (i = 0; i < argc; ++i) {
         const GValue *gval = &param_values[i];
-        gboolean no_copy;
+        JSBool ok;
 
-        no_copy = FALSE;
-
-        if (i >= 1 && signal_query.signal_id) {
-            no_copy = (signal_query.param_types[i - 1] & G_SIGNAL_TYPE_STATIC_SCOPE) != 0;
+        if (marshaller == NULL) {
+            ok = gjs_value_from_g_value_internal(context, &argv[i], gval, FALSE, NULL, i);
+        } else {
+            const GjsSignalParam *param = &marshaller->params[i];
+
+            /* the converters are only valid for the exact declared type */
+            if (param->convert != NULL &&
+                (G_VALUE_TYPE(gval) == param->gtype || param->convert == value_from_object))
+                ok = param->convert(context, &argv[i], gval);
+            else
+                ok = gjs_value_from_g_value_internal(context, &argv[i], gval,
+                                                     param->no_copy, &marshaller->query, i);
         }
 
-        if (!gjs_value_from_g_value_internal(context, &argv[i], gval, no_copy, &signal_query, i)) {
+        if (!ok) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Unable to convert arg %d in order to invoke closure",
                       i);
@@ -125,15 +418,15 @@ closure_marshal(GClosure        *closure,
         }
     }
 
-    gjs_closure_invoke(closure, argc, argv, &rval);
+    gjs_closure_invoke(closure, argc, argv, rval);
 
     if (return_value != NULL) {
-        if (rval == JSVAL_VOID) {
+        if (*rval == JSVAL_VOID) {
             /* something went wrong invoking, error should be set already */
             goto cleanup;
         }
 
-        if (!gjs_value_to_g_value(context, rval, return_value)) {
+        if (!gjs_value_to_g_value(context, *rval, return_value)) {
             gjs_debug(GJS_DEBUG_GCLOSURE,
                       "Unable to convert return value when invoking closure");
             gjs_log_exception(context, NULL);
@@ -142,9 +435,13 @@ closure_marshal(GClosure        *closure,
     }
 
  cleanup:
-    gjs_unroot_value_locations(context, argv, argc);
-    JS_RemoveValueRoot(context, &rval);
-    JS_EndRequest(context);
+    if (stack != NULL) {
+        gjs_set_values(context, argv, argc + 1, JSVAL_VOID);
+        stack->used -= argc + 1;
+    } else {
+        gjs_unroot_value_locations(context, argv, argc + 1);
+    }
+    gjs_closure_end_dispatch(&dispatch);
 }
 
 GClosure*
@@ -154,10 +451,17 @@ gjs_closure_new_for_signal(JSContext  *context,
                            guint       signal_id)
 {
     GClosure *closure;
+    GjsSignalMarshaller *marshaller;
+
+    marshaller = get_signal_marshaller(signal_id);
+    if (marshaller == NULL) {
+        gjs_throw(context, "Can't connect to invalid signal %u", signal_id);
+        return NULL;
+    }
 
     closure = gjs_closure_new(context, callable, description);
 
-    g_closure_set_meta_marshal(closure, GUINT_TO_POINTER(signal_id), closure_marshal);
+    g_closure_set_meta_marshal(closure, marshaller, closure_marshal);
 
     return closure;
 }
@@ -208,6 +512,7 @@ gjs_value_to_g_value_internal(JSContext    *context,
                               gboolean      no_copy)
 {
     GType gtype;
+    ValueKind kind;
 
     gtype = G_VALUE_TYPE(gvalue);
 
@@ -230,8 +535,10 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       "Converting jsval to gtype %s",
                       g_type_name(gtype));
 
+    kind = get_value_kind(gtype);
 
-    if (gtype == G_TYPE_STRING) {
+    switch (kind) {
+    case VALUE_KIND_STRING:
         /* Don't use ValueToString since we don't want to just toString()
          * everything automatically
          */
@@ -251,7 +558,8 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_CHAR) {
+        break;
+    case VALUE_KIND_CHAR: {
         gint32 i;
         if (JS_ValueToInt32(context, value, &i) && i >= SCHAR_MIN && i <= SCHAR_MAX) {
             g_value_set_char(gvalue, (signed char)i);
@@ -261,7 +569,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_UCHAR) {
+    }
+        break;
+    case VALUE_KIND_UCHAR: {
         guint16 i;
         if (JS_ValueToUint16(context, value, &i) && i <= UCHAR_MAX) {
             g_value_set_uchar(gvalue, (unsigned char)i);
@@ -271,7 +581,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_INT) {
+    }
+        break;
+    case VALUE_KIND_INT: {
         gint32 i;
         if (JS_ValueToInt32(context, value, &i)) {
             g_value_set_int(gvalue, i);
@@ -281,7 +593,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_DOUBLE) {
+    }
+        break;
+    case VALUE_KIND_DOUBLE: {
         gdouble d;
         if (JS_ValueToNumber(context, value, &d)) {
             g_value_set_double(gvalue, d);
@@ -291,7 +605,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_FLOAT) {
+    }
+        break;
+    case VALUE_KIND_FLOAT: {
         gdouble d;
         if (JS_ValueToNumber(context, value, &d)) {
             g_value_set_float(gvalue, d);
@@ -301,7 +617,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_UINT) {
+    }
+        break;
+    case VALUE_KIND_UINT: {
         guint32 i;
         if (JS_ValueToECMAUint32(context, value, &i)) {
             g_value_set_uint(gvalue, i);
@@ -311,7 +629,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_BOOLEAN) {
+    }
+        break;
+    case VALUE_KIND_BOOLEAN: {
         JSBool b;
 
         /* JS_ValueToBoolean() pretty much always succeeds,
@@ -326,7 +646,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE)) {
+    }
+        break;
+    case VALUE_KIND_OBJECT: {
         GObject *gobj;
 
         gobj = NULL;
@@ -345,7 +667,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
         }
 
         g_value_set_object(gvalue, gobj);
-    } else if (gtype == G_TYPE_STRV) {
+    }
+        break;
+    case VALUE_KIND_STRV:
         if (JSVAL_IS_NULL(value)) {
             /* do nothing */
         } else if (gjs_object_has_property(context,
@@ -381,7 +705,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       gjs_get_type_name(value));
             return JS_FALSE;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_BOXED)) {
+        break;
+    case VALUE_KIND_CONTAINER:
+    case VALUE_KIND_BOXED: {
         void *gboxed;
 
         gboxed = NULL;
@@ -403,7 +729,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
             g_value_set_static_boxed(gvalue, gboxed);
         else
             g_value_set_boxed(gvalue, gboxed);
-    } else if (g_type_is_a(gtype, G_TYPE_ENUM)) {
+    }
+        break;
+    case VALUE_KIND_ENUM: {
         gint64 value_int64;
 
         if (gjs_value_to_int64 (context, value, &value_int64)) {
@@ -427,7 +755,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                          g_type_name(gtype));
             return JS_FALSE;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_FLAGS)) {
+    }
+        break;
+    case VALUE_KIND_FLAGS: {
         gint64 value_int64;
 
         if (gjs_value_to_int64 (context, value, &value_int64)) {
@@ -443,7 +773,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       g_type_name(gtype));
             return JS_FALSE;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_PARAM)) {
+    }
+        break;
+    case VALUE_KIND_PARAM: {
         void *gparam;
 
         gparam = NULL;
@@ -462,7 +794,9 @@ gjs_value_to_g_value_internal(JSContext    *context,
         }
 
         g_value_set_param(gvalue, gparam);
-    } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
+    }
+        break;
+    case VALUE_KIND_POINTER: {
         if (JSVAL_IS_NULL(value)) {
             /* Nothing to do */
         } else {
@@ -470,35 +804,40 @@ gjs_value_to_g_value_internal(JSContext    *context,
                       "Cannot convert non-null JS value to G_POINTER");
             return JS_FALSE;
         }
-    } else if (JSVAL_IS_NUMBER(value) &&
-               g_value_type_transformable(G_TYPE_INT, gtype)) {
-        /* Only do this crazy gvalue transform stuff after we've
-         * exhausted everything else. Adding this for
-         * e.g. ClutterUnit.
-         */
-        gint32 i;
-        if (JS_ValueToInt32(context, value, &i)) {
-            GValue int_value = { 0, };
-            g_value_init(&int_value, G_TYPE_INT);
-            g_value_set_int(&int_value, i);
-            g_value_transform(&int_value, gvalue);
+    }
+        break;
+    default:
+        if (JSVAL_IS_NUMBER(value) &&
+            g_value_type_transformable(G_TYPE_INT, gtype)) {
+            /* Only do this crazy gvalue transform stuff after we've
+             * exhausted everything else. Adding this for
+             * e.g. ClutterUnit.
+             */
+            gint32 i;
+            if (JS_ValueToInt32(context, value, &i)) {
+                GValue int_value = { 0, };
+                g_value_init(&int_value, G_TYPE_INT);
+                g_value_set_int(&int_value, i);
+                g_value_transform(&int_value, gvalue);
+            } else {
+                gjs_throw(context,
+                          "Wrong type %s; integer expected",
+                          gjs_get_type_name(value));
+                return JS_FALSE;
+            }
         } else {
+            gjs_debug(GJS_DEBUG_GCLOSURE, "jsval is number %d gtype fundamental %d transformable to int %d from int %d",
+                      JSVAL_IS_NUMBER(value),
+                      G_TYPE_IS_FUNDAMENTAL(gtype),
+                      g_value_type_transformable(gtype, G_TYPE_INT),
+                      g_value_type_transformable(G_TYPE_INT, gtype));
+
             gjs_throw(context,
-                      "Wrong type %s; integer expected",
-                      gjs_get_type_name(value));
+                      "Don't know how to convert JavaScript object to GType %s",
+                      g_type_name(gtype));
             return JS_FALSE;
         }
-    } else {
-        gjs_debug(GJS_DEBUG_GCLOSURE, "jsval is number %d gtype fundamental %d transformable to int %d from int %d",
-                  JSVAL_IS_NUMBER(value),
-                  G_TYPE_IS_FUNDAMENTAL(gtype),
-                  g_value_type_transformable(gtype, G_TYPE_INT),
-                  g_value_type_transformable(G_TYPE_INT, gtype));
-
-        gjs_throw(context,
-                  "Don't know how to convert JavaScript object to GType %s",
-                  g_type_name(gtype));
-        return JS_FALSE;
+        break;
     }
 
     return JS_TRUE;
@@ -559,6 +898,7 @@ gjs_value_from_g_value_internal(JSContext    *context,
                                 gint          arg_n)
 {
     GType gtype;
+    ValueKind kind;
 
     gtype = G_VALUE_TYPE(gvalue);
 
@@ -566,7 +906,10 @@ gjs_value_from_g_value_internal(JSContext    *context,
                       "Converting gtype %s to jsval",
                       g_type_name(gtype));
 
-    if (gtype == G_TYPE_STRING) {
+    kind = get_value_kind(gtype);
+
+    switch (kind) {
+    case VALUE_KIND_STRING: {
         const char *v;
         v = g_value_get_string(gvalue);
         if (v == NULL) {
@@ -577,35 +920,51 @@ gjs_value_from_g_value_internal(JSContext    *context,
             if (!gjs_string_from_utf8(context, v, -1, value_p))
                 return JS_FALSE;
         }
-    } else if (gtype == G_TYPE_CHAR) {
+    }
+        break;
+    case VALUE_KIND_CHAR: {
         char v;
         v = g_value_get_char(gvalue);
         *value_p = INT_TO_JSVAL(v);
-    } else if (gtype == G_TYPE_UCHAR) {
+    }
+        break;
+    case VALUE_KIND_UCHAR: {
         unsigned char v;
         v = g_value_get_uchar(gvalue);
         *value_p = INT_TO_JSVAL(v);
-    } else if (gtype == G_TYPE_INT) {
+    }
+        break;
+    case VALUE_KIND_INT: {
         int v;
         v = g_value_get_int(gvalue);
         return JS_NewNumberValue(context, v, value_p);
-    } else if (gtype == G_TYPE_UINT) {
+    }
+        break;
+    case VALUE_KIND_UINT: {
         uint v;
         v = g_value_get_uint(gvalue);
         return JS_NewNumberValue(context, v, value_p);
-    } else if (gtype == G_TYPE_DOUBLE) {
+    }
+        break;
+    case VALUE_KIND_DOUBLE: {
         double d;
         d = g_value_get_double(gvalue);
         return JS_NewNumberValue(context, d, value_p);
-    } else if (gtype == G_TYPE_FLOAT) {
+    }
+        break;
+    case VALUE_KIND_FLOAT: {
         double d;
         d = g_value_get_float(gvalue);
         return JS_NewNumberValue(context, d, value_p);
-    } else if (gtype == G_TYPE_BOOLEAN) {
+    }
+        break;
+    case VALUE_KIND_BOOLEAN: {
         gboolean v;
         v = g_value_get_boolean(gvalue);
         *value_p = BOOLEAN_TO_JSVAL(v);
-    } else if (g_type_is_a(gtype, G_TYPE_OBJECT) || g_type_is_a(gtype, G_TYPE_INTERFACE)) {
+    }
+        break;
+    case VALUE_KIND_OBJECT: {
         GObject *gobj;
         JSObject *obj;
 
@@ -613,21 +972,21 @@ gjs_value_from_g_value_internal(JSContext    *context,
 
         obj = gjs_object_from_g_object(context, gobj);
         *value_p = OBJECT_TO_JSVAL(obj);
-    } else if (gtype == G_TYPE_STRV) {
+    }
+        break;
+    case VALUE_KIND_STRV:
         if (!gjs_array_from_strv (context,
                                   value_p,
                                   g_value_get_boxed (gvalue))) {
             gjs_throw(context, "Failed to convert strv to array");
             return JS_FALSE;
         }
-    } else if (g_type_is_a(gtype, G_TYPE_HASH_TABLE) ||
-               g_type_is_a(gtype, _array_type) ||
-               g_type_is_a(gtype, _byte_array_type) ||
-               g_type_is_a(gtype, _ptr_array_type)) {
+        break;
+    case VALUE_KIND_CONTAINER:
         gjs_throw(context,
                   "Unable to introspect element-type of container in GValue");
         return JS_FALSE;
-    } else if (g_type_is_a(gtype, G_TYPE_BOXED)) {
+    case VALUE_KIND_BOXED: {
         GjsBoxedCreationFlags boxed_flags;
         GIBaseInfo *info;
         void *gboxed;
@@ -665,9 +1024,11 @@ gjs_value_from_g_value_internal(JSContext    *context,
             return JS_FALSE;
         }
         *value_p = OBJECT_TO_JSVAL(obj);
-    } else if (g_type_is_a(gtype, G_TYPE_ENUM)) {
+    }
+        break;
+    case VALUE_KIND_ENUM:
         return convert_int_to_enum(context, value_p, gtype, g_value_get_enum(gvalue));
-    } else if (g_type_is_a(gtype, G_TYPE_PARAM)) {
+    case VALUE_KIND_PARAM: {
         GParamSpec *gparam;
         JSObject *obj;
 
@@ -675,70 +1036,77 @@ gjs_value_from_g_value_internal(JSContext    *context,
 
         obj = gjs_param_from_g_param(context, gparam);
         *value_p = OBJECT_TO_JSVAL(obj);
-    } else if (signal_query && g_type_is_a(gtype, G_TYPE_POINTER)) {
-        JSBool res;
-        GArgument arg;
-        GIArgInfo *arg_info;
-        GIBaseInfo *obj;
-        GISignalInfo *signal_info;
-        GITypeInfo type_info;
-
-        obj = g_irepository_find_by_gtype(NULL, signal_query->itype);
-        if (!obj) {
-            gjs_throw(context, "Signal argument with GType %s isn't introspectable",
-                      g_type_name(signal_query->itype));
-            return JS_FALSE;
-        }
+    }
+        break;
+    case VALUE_KIND_POINTER:
+        if (signal_query) {
+            JSBool res;
+            GArgument arg;
+            GIArgInfo *arg_info;
+            GIBaseInfo *obj;
+            GISignalInfo *signal_info;
+            GITypeInfo type_info;
+
+            obj = g_irepository_find_by_gtype(NULL, signal_query->itype);
+            if (!obj) {
+                gjs_throw(context, "Signal argument with GType %s isn't introspectable",
+                          g_type_name(signal_query->itype));
+                return JS_FALSE;
+            }
 
-        signal_info = g_object_info_find_signal((GIObjectInfo*)obj, signal_query->signal_name);
+            signal_info = g_object_info_find_signal((GIObjectInfo*)obj, signal_query->signal_name);
 
-        if (!signal_info) {
-            gjs_throw(context, "Unknown signal.");
-            g_base_info_unref((GIBaseInfo*)obj);
-            return JS_FALSE;
-        }
-        arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
-        g_arg_info_load_type(arg_info, &type_info);
+            if (!signal_info) {
+                gjs_throw(context, "Unknown signal.");
+                g_base_info_unref((GIBaseInfo*)obj);
+                return JS_FALSE;
+            }
+            arg_info = g_callable_info_get_arg(signal_info, arg_n - 1);
+            g_arg_info_load_type(arg_info, &type_info);
 
-        arg.v_pointer = g_value_get_pointer(gvalue);
+            arg.v_pointer = g_value_get_pointer(gvalue);
 
-        res = gjs_value_from_g_argument(context, value_p, &type_info, &arg);
+            res = gjs_value_from_g_argument(context, value_p, &type_info, &arg);
 
-        g_base_info_unref((GIBaseInfo*)arg_info);
-        g_base_info_unref((GIBaseInfo*)signal_info);
-        g_base_info_unref((GIBaseInfo*)obj);
-        return res;
-    } else if (g_type_is_a(gtype, G_TYPE_POINTER)) {
-        gpointer pointer;
+            g_base_info_unref((GIBaseInfo*)arg_info);
+            g_base_info_unref((GIBaseInfo*)signal_info);
+            g_base_info_unref((GIBaseInfo*)obj);
+            return res;
+        } else {
+            gpointer pointer;
 
-        pointer = g_value_get_pointer(gvalue);
+            pointer = g_value_get_pointer(gvalue);
 
-        if (pointer == NULL) {
-            *value_p = JSVAL_NULL;
+            if (pointer == NULL) {
+                *value_p = JSVAL_NULL;
+            } else {
+                gjs_throw(context,
+                          "Can't convert non-null pointer to JS value");
+                return JS_FALSE;
+            }
+        }
+        break;
+    default:
+        if (g_value_type_transformable(gtype, G_TYPE_DOUBLE)) {
+            GValue double_value = { 0, };
+            double v;
+            g_value_init(&double_value, G_TYPE_DOUBLE);
+            g_value_transform(gvalue, &double_value);
+            v = g_value_get_double(&double_value);
+            return JS_NewNumberValue(context, v, value_p);
+        } else if (g_value_type_transformable(gtype, G_TYPE_INT)) {
+            GValue int_value = { 0, };
+            int v;
+            g_value_init(&int_value, G_TYPE_INT);
+            g_value_transform(gvalue, &int_value);
+            v = g_value_get_int(&int_value);
+            return JS_NewNumberValue(context, v, value_p);
         } else {
             gjs_throw(context,
-                      "Can't convert non-null pointer to JS value");
+                      "Don't know how to convert GType %s to JavaScript object",
+                      g_type_name(gtype));
             return JS_FALSE;
         }
-    } else if (g_value_type_transformable(gtype, G_TYPE_DOUBLE)) {
-        GValue double_value = { 0, };
-        double v;
-        g_value_init(&double_value, G_TYPE_DOUBLE);
-        g_value_transform(gvalue, &double_value);
-        v = g_value_get_double(&double_value);
-        return JS_NewNumberValue(context, v, value_p);
-    } else if (g_value_type_transformable(gtype, G_TYPE_INT)) {
-        GValue int_value = { 0, };
-        int v;
-        g_value_init(&int_value, G_TYPE_INT);
-        g_value_transform(gvalue, &int_value);
-        v = g_value_get_int(&int_value);
-        return JS_NewNumberValue(context, v, value_p);
-    } else {
-        gjs_throw(context,
-                  "Don't know how to convert GType %s to JavaScript object",
-                  g_type_name(gtype));
-        return JS_FALSE;
     }
 
     return JS_TRUE;
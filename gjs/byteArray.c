@@ -791,16 +791,18 @@ from_array_func(JSContext *context,
     return ret;
 }
 
+/* Creates a ByteArray holding a copy of @length bytes at @data */
 JSObject *
-gjs_byte_array_from_byte_array (JSContext *context,
-                                GByteArray *array)
+gjs_byte_array_from_data (JSContext *context,
+                          gsize      length,
+                          gpointer   data)
 {
     JSObject *object;
     ByteArrayInstance *priv;
     static gboolean init = FALSE;
 
     g_return_val_if_fail(context != NULL, NULL);
-    g_return_val_if_fail(array != NULL, NULL);
+    g_return_val_if_fail(data != NULL || length == 0, NULL);
 
     if (!init) {
         jsval rval;
@@ -819,13 +821,21 @@ gjs_byte_array_from_byte_array (JSContext *context,
     priv = g_slice_new0(ByteArrayInstance);
     g_assert(priv_from_js(context, object) == NULL);
     JS_SetPrivate(context, object, priv);
-    priv->array = g_byte_array_new();
-    priv->array->data = g_memdup(array->data, array->len);
-    priv->array->len = array->len;
+    priv->array = gjs_g_byte_array_new(0);
+    g_byte_array_append(priv->array, data, length);
 
     return object;
 }
 
+JSObject *
+gjs_byte_array_from_byte_array (JSContext *context,
+                                GByteArray *array)
+{
+    g_return_val_if_fail(array != NULL, NULL);
+
+    return gjs_byte_array_from_data(context, array->len, array->data);
+}
+
 GByteArray*
 gjs_byte_array_get_byte_array (JSContext  *context,
                                JSObject   *object)
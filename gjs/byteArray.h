@@ -39,6 +39,9 @@ JSBool        gjs_define_byte_array_stuff    (JSContext  *context,
 
 JSObject *    gjs_byte_array_from_byte_array (JSContext  *context,
                                               GByteArray *array);
+JSObject *    gjs_byte_array_from_data       (JSContext  *context,
+                                              gsize       length,
+                                              gpointer    data);
 GByteArray *   gjs_byte_array_get_byte_array (JSContext  *context,
                                               JSObject   *object);
 
@@ -62,6 +62,8 @@ G_BEGIN_DECLS
 #define JSID_VOID JSVAL_VOID
 #define JSID_IS_VOID(id) (id == JSVAL_VOID)
 #define INT_TO_JSID(i) ((jsid) INT_TO_JSVAL(i))
+#define JSID_IS_STRING(id) JSVAL_IS_STRING(id)
+#define JSID_BITS(id) (id)
 #endif
 
 /* commit 66c8ad02543b, Spidermonkey > Aug 16 2010
@@ -56,6 +56,9 @@ typedef struct {
     /* In a thread-safe future we'd keep this in per-thread data */
     ContextFrame current_frame;
     GSList *context_stack;
+
+    /* Per-runtime state of other modules, see gjs_runtime_set_data() */
+    GData *data;
 } RuntimeData;
 
 typedef struct {
@@ -235,6 +238,52 @@ gjs_runtime_get_current_context(JSRuntime *runtime)
     return rd->current_frame.context;
 }
 
+/**
+ * gjs_runtime_get_data:
+ * @runtime: a #JSRuntime
+ * @key: quark the data was stored under
+ *
+ * Return value: the data stored with gjs_runtime_set_data(), or %NULL
+ */
+void*
+gjs_runtime_get_data(JSRuntime  *runtime,
+                     GQuark      key)
+{
+    RuntimeData *rd;
+
+    rd = get_data_from_runtime(runtime);
+
+    return g_datalist_id_get_data(&rd->data, key);
+}
+
+/**
+ * gjs_runtime_set_data:
+ * @runtime: a #JSRuntime
+ * @key: quark to store the data under
+ * @data: data to associate with the runtime
+ * @dnotify: function to free @data, or %NULL
+ *
+ * Associates per-runtime state with @runtime, for modules that can't
+ * keep it in static variables. @dnotify is called when the data is
+ * replaced, or after JS_DestroyRuntime() when the runtime goes away,
+ * so it must not use the JSAPI.
+ *
+ * Callers on hot paths should intern @key once and keep it, rather
+ * than looking it up from a string each time.
+ */
+void
+gjs_runtime_set_data(JSRuntime     *runtime,
+                     GQuark         key,
+                     void          *data,
+                     GDestroyNotify dnotify)
+{
+    RuntimeData *rd;
+
+    rd = get_data_from_runtime(runtime);
+
+    g_datalist_id_set_data_full(&rd->data, key, data, dnotify);
+}
+
 static JSClass global_class = {
     "GjsGlobal", JSCLASS_GLOBAL_FLAGS,
     JS_PropertyStub, JS_PropertyStub, JS_PropertyStub, JS_StrictPropertyStub,
@@ -300,6 +349,7 @@ gjs_runtime_init(JSRuntime *runtime)
 
     rd = g_slice_new0(RuntimeData);
     rd->dynamic_classes = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_datalist_init(&rd->data);
     JS_SetRuntimePrivate(runtime, rd);
 }
 
@@ -347,6 +397,7 @@ gjs_runtime_destroy(JSRuntime *runtime)
     }
 
     g_hash_table_destroy(rd->dynamic_classes);
+    g_datalist_clear(&rd->data);
     g_slice_free(RuntimeData, rd);
 }
 
@@ -201,6 +201,27 @@ JSContext*  gjs_runtime_get_default_context  (JSRuntime       *runtime);
 void        gjs_runtime_push_context         (JSRuntime       *runtime,
                                               JSContext       *context);
 void        gjs_runtime_pop_context          (JSRuntime       *runtime);
+
+/* Defines a static q_n##_quark() returning the quark for QN, interned
+ * on first use, to key gjs_runtime_get_data(); like G_DEFINE_QUARK(),
+ * which needs a newer GLib.
+ */
+#define GJS_DEFINE_QUARK(QN, q_n)                                       \
+static GQuark                                                           \
+q_n##_quark(void)                                                       \
+{                                                                       \
+    static GQuark quark = 0;                                            \
+    if (G_UNLIKELY(quark == 0))                                         \
+        quark = g_quark_from_static_string(#QN);                        \
+    return quark;                                                       \
+}
+
+void*       gjs_runtime_get_data             (JSRuntime       *runtime,
+                                              GQuark           key);
+void        gjs_runtime_set_data             (JSRuntime       *runtime,
+                                              GQuark           key,
+                                              void            *data,
+                                              GDestroyNotify   dnotify);
 JSObject*   gjs_get_import_global            (JSContext       *context);
 gboolean    gjs_object_has_property          (JSContext       *context,
                                               JSObject        *obj,
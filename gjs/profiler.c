@@ -37,6 +37,12 @@ static GjsProfiler *global_profiler = NULL;
 static char        *global_profiler_output = NULL;
 static guint        global_profiler_output_counter = 0;
 static guint        global_profile_idle = 0;
+static GSList      *global_dump_funcs = NULL; /* GjsProfilerDumpClosure */
+
+typedef struct {
+    GjsProfilerDumpFunc func;
+    void *data;
+} GjsProfilerDumpClosure;
 
 
 typedef struct _GjsProfileData     GjsProfileData;
@@ -444,6 +450,7 @@ gjs_profiler_dump(GjsProfiler *self)
 {
     char *filename;
     FILE *fp;
+    GSList *iter;
 
     filename = g_strdup_printf("%s.%u.%u",
                                global_profiler_output,
@@ -464,9 +471,29 @@ gjs_profiler_dump(GjsProfiler *self)
                          by_file_dump_one,
                          fp);
 
+    for (iter = global_dump_funcs; iter != NULL; iter = iter->next) {
+        GjsProfilerDumpClosure *closure = iter->data;
+
+        fprintf(fp, "\n");
+        (* closure->func) (fp, closure->data);
+    }
+
     fclose(fp);
 }
 
+void
+gjs_profiler_add_dump_func(GjsProfilerDumpFunc func,
+                           void               *data)
+{
+    GjsProfilerDumpClosure *closure;
+
+    closure = g_slice_new(GjsProfilerDumpClosure);
+    closure->func = func;
+    closure->data = data;
+
+    global_dump_funcs = g_slist_append(global_dump_funcs, closure);
+}
+
 GjsProfiler *
 gjs_profiler_new(JSRuntime *runtime)
 {
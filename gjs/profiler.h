@@ -24,6 +24,7 @@
 #ifndef __GJS_PROFILER_H__
 #define __GJS_PROFILER_H__
 
+#include <stdio.h>
 #include <jsapi.h>
 #include <glib.h>
 
@@ -37,6 +38,13 @@ void         gjs_profiler_reset(GjsProfiler *self);
 
 void gjs_profiler_dump   (GjsProfiler *self);
 
+/* Lets other parts of gjs append their own tables to each profile dump */
+typedef void (*GjsProfilerDumpFunc) (FILE *fp,
+                                     void *data);
+
+void gjs_profiler_add_dump_func(GjsProfilerDumpFunc func,
+                                void               *data);
+
 G_END_DECLS
 
 #endif /* __GJS_PROFILER_H__ */
@@ -119,6 +119,7 @@ closure_source_func(void *data)
     JSBool bool_val;
     JSRuntime *runtime;
     JSContext *context;
+    GjsClosureDispatch dispatch;
 
     closure = data;
 
@@ -128,7 +129,7 @@ closure_source_func(void *data)
     runtime = gjs_closure_get_runtime(closure);
     context = gjs_runtime_get_current_context(runtime);
 
-    JS_BeginRequest(context);
+    gjs_closure_begin_dispatch(&dispatch, context);
 
     retval = JSVAL_VOID;
     JS_AddValueRoot(context, &retval);
@@ -147,7 +148,7 @@ closure_source_func(void *data)
 
     JS_RemoveValueRoot(context, &retval);
 
-    JS_EndRequest(context);
+    gjs_closure_end_dispatch(&dispatch);
     return bool_val;
 }
 
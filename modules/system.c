@@ -0,0 +1,59 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright (c) 2011  litl, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "system.h"
+#include <gjs/gjs-module.h>
+#include <gjs/compat.h>
+#include "gi/function.h"
+
+#include <glib.h>
+#include <jsapi.h>
+
+static JSBool
+gjs_system_gi_stats(JSContext *context,
+                    uintN      argc,
+                    jsval     *vp)
+{
+    jsval retval;
+
+    if (!gjs_get_cinvoke_stats(context, &retval))
+        return JS_FALSE;
+
+    JS_SET_RVAL(context, vp, retval);
+    return JS_TRUE;
+}
+
+JSBool
+gjs_define_system_stuff(JSContext      *context,
+                        JSObject       *module_obj)
+{
+    if (!JS_DefineFunction(context, module_obj,
+                           "giStats",
+                           (JSNative)gjs_system_gi_stats,
+                           0, GJS_MODULE_PROP_FLAGS | JSFUN_FAST_NATIVE))
+        return JS_FALSE;
+
+    return JS_TRUE;
+}
+
+GJS_REGISTER_NATIVE_MODULE("system", gjs_define_system_stuff)
@@ -284,8 +284,15 @@ function testArrayIn() {
     assertEquals(10, Everything.test_array_gint8_in(4, [1,2,3,4]));
     assertEquals(10, Everything.test_array_gint16_in(4, [1,2,3,4]));
     assertEquals(10, Everything.test_array_gint32_in(4, [1,2,3,4]));
-    // FIXME: arrays of int64 are unimplemented
-    //assertEquals(10, Everything.test_array_gint64_in(4, [1,2,3,4]));
+    assertEquals(10, Everything.test_array_gint64_in(4, [1,2,3,4]));
+    assertRaises(function() { Everything.test_array_gint64_in(2, [1, NaN]); });
+    assertRaises(function() { Everything.test_array_gint64_in(2, [1, Infinity]); });
+    assertRaises(function() { Everything.test_array_gint64_in(2, [1, Math.pow(2, 63)]); });
+
+    // ByteArrays are copied in directly, and widened for larger types
+    let byteArray = imports.byteArray.fromArray([1,2,3,4]);
+    assertEquals(10, Everything.test_array_gint8_in(4, byteArray));
+    assertEquals(10, Everything.test_array_gint32_in(4, byteArray));
 
     // implicit conversions from strings to int arrays
     assertEquals(10, Everything.test_array_gint8_in(4, "\x01\x02\x03\x04"));
@@ -294,7 +301,21 @@ function testArrayIn() {
 }
 
 function testArrayOut() {
-    // FIXME: test_array_int_full_out and test_array_int_none_out unimplemented
+    let [array, length] = Everything.test_array_int_full_out();
+    assertEquals(5, length);
+    assertEquals(5, array.length);
+    for (let i = 0; i < length; i++)
+        assertEquals(i, array[i]);
+
+    [array, length] = Everything.test_array_int_none_out();
+    assertEquals(5, length);
+    assertEquals("1,2,3,4,5", array.join(","));
+
+    // C APIs return NULL for an empty array
+    [array, length] = Everything.test_array_int_null_out();
+    assertEquals(0, length);
+    assertNotNull(array);
+    assertEquals(0, array.length);
 }
 
 /* GHash type */
@@ -446,6 +467,26 @@ function testObjTortureSignature1Success() {
     assertEquals(q, 14);
 }
 
+function testCallMany() {
+    let results = Everything.test_int.callMany([[1], [-2], [3]]);
+    assertEquals(3, results.length);
+    assertEquals(1, results[0]);
+    assertEquals(-2, results[1]);
+    assertEquals(3, results[2]);
+
+    let o = new Everything.TestObj();
+    results = Everything.TestObj.prototype.torture_signature_0.callMany([[o, 42, 'foo', 7]]);
+    assertEquals(1, results.length);
+    assertEquals(84, results[0][1]);
+
+    assertRaises(function () {
+        Everything.test_int.callMany([[]]);
+    });
+    assertRaises(function () {
+        Everything.test_int.callMany(42);
+    });
+}
+
 function testStrvInGValue() {
     let v = Everything.test_strv_in_gvalue();
 
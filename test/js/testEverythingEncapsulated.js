@@ -1,6 +1,7 @@
 // application/javascript;version=1.8
 // This used to be called "Everything"
 const Everything = imports.gi.Regress;
+const GLib = imports.gi.GLib;
 if (!('assertEquals' in this)) { /* allow running this test standalone */
     imports.lang.copyPublicProperties(imports.jsUnit, this);
     gjstestRun = function() { return imports.jsUnit.gjstestRun(window); };
@@ -131,6 +132,91 @@ function testNestedSimpleBoxed() {
     assertEquals(43.5, simple2.nested_a.some_double);
 }
 
+function testStructScalarFields() {
+    // int32, int8 and double fields are read and written in place
+    let struct = new Everything.TestStructA();
+    struct.some_int = -2147483648;
+    struct.some_int8 = -128;
+    struct.some_double = -1.5e300;
+    assertEquals(-2147483648, struct.some_int);
+    assertEquals(-128, struct.some_int8);
+    assertEquals(-1.5e300, struct.some_double);
+
+    struct.some_int8 = 127;
+    assertEquals(127, struct.some_int8);
+
+    // Values that don't fit go the generic way, which rejects them
+    assertRaises(function() { struct.some_int8 = 128; });
+    assertRaises(function() { struct.some_int8 = -129; });
+    assertEquals(127, struct.some_int8);
+
+    // Non-numbers too; the generic path converts them
+    struct.some_int = "42";
+    assertEquals(42, struct.some_int);
+    struct.some_double = 7;
+    assertEquals(7, struct.some_double);
+
+    // int64 (glong on 64-bit)
+    let timeval = new GLib.TimeVal();
+    timeval.tv_sec = 1234567;
+    timeval.tv_usec = -1;
+    assertEquals(1234567, timeval.tv_sec);
+    assertEquals(-1, timeval.tv_usec);
+
+    // uint16
+    let pollfd = new GLib.PollFD();
+    pollfd.fd = 3;
+    pollfd.events = 65535;
+    assertEquals(3, pollfd.fd);
+    assertEquals(65535, pollfd.events);
+    assertRaises(function() { pollfd.events = 65536; });
+    assertRaises(function() { pollfd.revents = -1; });
+    assertEquals(0, pollfd.revents);
+
+    // booleans; anything else is converted by the generic path
+    let config = new GLib.TestConfig();
+    assertFalse(config.test_quick);
+    config.test_quick = true;
+    assertTrue(config.test_quick);
+    config.test_quick = false;
+    assertFalse(config.test_quick);
+    config.test_verbose = 1;
+    assertTrue(config.test_verbose);
+}
+
+function testSimpleStructWrapAndCopy() {
+    let struct = new Everything.TestStructA({ some_int: 42,
+                                              some_int8: 43,
+                                              some_double: 42.5 });
+
+    // clone() hands back a struct from C, which is copied when wrapped
+    let wrapped = struct.clone();
+    wrapped.some_int = 7;
+    assertEquals(7, wrapped.some_int);
+    assertEquals(42, struct.some_int);
+    assertEquals(43, wrapped.some_int8);
+    assertEquals(42.5, wrapped.some_double);
+
+    let copy = new Everything.TestStructA(wrapped);
+    copy.some_int8 = 8;
+    assertEquals(8, copy.some_int8);
+    assertEquals(43, wrapped.some_int8);
+    assertEquals(7, copy.some_int);
+}
+
+function testOpaqueBoxedWrapAndCopy() {
+    // A registered boxed with no visible fields, returned from C
+    let loop = GLib.MainLoop.new(null, false);
+    assertTrue(loop instanceof GLib.MainLoop);
+    assertFalse(loop.is_running());
+    assertNotNull(loop.get_context());
+
+    let copy = new GLib.MainLoop(loop);
+    assertTrue(copy instanceof GLib.MainLoop);
+    assertFalse(copy.is_running());
+    assertNotNull(copy.get_context());
+}
+
 function testBoxed() {
     let boxed = new Everything.TestBoxed();
     boxed.some_int8 = 42;
@@ -0,0 +1,39 @@
+// application/javascript;version=1.8
+const System = imports.system;
+const Everything = imports.gi.Regress;
+const GLib = imports.gi.GLib;
+
+function testGIStats() {
+    // "make check" runs this both with and without GJS_DEBUG_GI_STATS
+    if (GLib.getenv('GJS_DEBUG_GI_STATS') == null) {
+        Everything.test_int16(1);
+        for (let name in System.giStats())
+            fail('Statistics recorded while disabled: ' + name);
+        return;
+    }
+
+    // Make sure the function has been called at least once
+    Everything.test_int16(1);
+
+    let before = System.giStats()['Regress.test_int16'];
+    assertNotUndefined(before);
+    assertTrue(before.calls >= 1);
+
+    for (let i = 0; i < 10; i++)
+        Everything.test_int16(i);
+
+    let after = System.giStats()['Regress.test_int16'];
+    assertEquals(before.calls + 10, after.calls);
+    assertTrue(after.totalTime >= before.totalTime);
+    assertTrue(after.maxTime >= before.maxTime);
+
+    let histogramCalls = 0;
+    for (let i = 0; i < after.histogram.length; i++)
+        histogramCalls += after.histogram[i];
+    assertEquals(after.calls, histogramCalls);
+
+    // Functions that were never called aren't listed
+    assertUndefined(System.giStats()['Regress.test_int16_never_called']);
+}
+
+gjstestRun();